@@ -9,6 +9,11 @@
       "libraries": [
         "<!(node find-plutobook.js --lib)"
       ],
+      "conditions": [
+        ["OS!='win'", {
+          "libraries": ["-lz"]
+        }]
+      ],
       "xcode_settings": {
         "OTHER_CFLAGS": ["-Wno-missing-field-initializers"]
       }
@@ -0,0 +1,475 @@
+#!/usr/bin/env node
+'use strict';
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const crypto = require('crypto');
+const { parseArgs } = require('util');
+const { pathToFileURL } = require('url');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const INPUT_EXTENSIONS = new Set(['.html', '.htm', '.xhtml', '.xml', '.svg']);
+const MANIFEST_NAME = '.plutoprint-manifest.json';
+
+const USAGE = `Usage: plutoprint [options] <input...>
+
+Converts HTML, XHTML, XML and SVG files to PDF or PNG using a pool of
+worker threads. Inputs may be files, directories (searched recursively)
+or glob patterns such as "docs/**/*.html".
+
+Output:
+  -f, --format <pdf|png>      Output format (default: pdf)
+  -o, --output <dir>          Output directory, mirroring the input layout
+                              (default: next to each input)
+  -j, --jobs <n>              Number of worker threads (default: CPU count)
+  -i, --incremental <mode>    Skip unchanged inputs: mtime, hash or off
+                              (default: mtime)
+      --force                 Convert every input, same as --incremental off
+  -q, --quiet                 Only print the summary and errors
+
+Book options:
+      --size <size>           Page size, e.g. a4, letter
+      --media <type>          Media type: print or screen
+      --width <length>        Page width
+      --height <length>       Page height
+      --margin <length>       Margin for all sides
+      --margin-top <length>
+      --margin-right <length>
+      --margin-bottom <length>
+      --margin-left <length>
+      --user-style <file>     Stylesheet applied to every input
+      --resources <tar>       Preloaded resource bundle
+      --offline               Never fetch network resources
+      --max-pages <n>         Fail inputs with more pages than this
+      --max-resource-bytes <n>
+      --max-resource-count <n>
+      --max-layout-ms <n>
+
+PNG options:
+      --scale <factor>        Device pixel ratio
+      --dpi <dpi>             Target resolution
+
+  -h, --help                  Show this help
+  -v, --version               Show version information`;
+
+const OPTIONS = {
+    format: { type: 'string', short: 'f', default: 'pdf' },
+    output: { type: 'string', short: 'o' },
+    jobs: { type: 'string', short: 'j' },
+    incremental: { type: 'string', short: 'i', default: 'mtime' },
+    force: { type: 'boolean' },
+    quiet: { type: 'boolean', short: 'q' },
+    size: { type: 'string' },
+    media: { type: 'string' },
+    width: { type: 'string' },
+    height: { type: 'string' },
+    margin: { type: 'string' },
+    'margin-top': { type: 'string' },
+    'margin-right': { type: 'string' },
+    'margin-bottom': { type: 'string' },
+    'margin-left': { type: 'string' },
+    'user-style': { type: 'string' },
+    resources: { type: 'string' },
+    offline: { type: 'boolean' },
+    'max-pages': { type: 'string' },
+    'max-resource-bytes': { type: 'string' },
+    'max-resource-count': { type: 'string' },
+    'max-layout-ms': { type: 'string' },
+    scale: { type: 'string' },
+    dpi: { type: 'string' },
+    help: { type: 'boolean', short: 'h' },
+    version: { type: 'boolean', short: 'v' }
+};
+
+function fail(message) {
+    console.error(`plutoprint: ${message}`);
+    process.exit(2);
+}
+
+function parseNumber(values, name) {
+    if(values[name] === undefined)
+        return undefined;
+    const number = Number(values[name]);
+    if(!Number.isFinite(number) || number < 0)
+        fail(`--${name} must be a non-negative number, got "${values[name]}"`);
+    return number;
+}
+
+function parseLength(value) {
+    if(value === undefined)
+        return undefined;
+    const number = Number(value);
+    return Number.isFinite(number) ? number : value;
+}
+
+function buildBookOptions(values) {
+    const options = {
+        size: values.size,
+        media: values.media,
+        width: parseLength(values.width),
+        height: parseLength(values.height),
+        margin: parseLength(values.margin),
+        marginTop: parseLength(values['margin-top']),
+        marginRight: parseLength(values['margin-right']),
+        marginBottom: parseLength(values['margin-bottom']),
+        marginLeft: parseLength(values['margin-left']),
+        resources: values.resources && path.resolve(values.resources),
+        offline: values.offline,
+        maxPages: parseNumber(values, 'max-pages'),
+        maxResourceBytes: parseNumber(values, 'max-resource-bytes'),
+        maxResourceCount: parseNumber(values, 'max-resource-count'),
+        maxLayoutMs: parseNumber(values, 'max-layout-ms')
+    };
+
+    for(const key of Object.keys(options)) {
+        if(options[key] === undefined) {
+            delete options[key];
+        }
+    }
+
+    return options;
+}
+
+function buildPngOptions(values) {
+    const options = { scale: parseNumber(values, 'scale'), dpi: parseNumber(values, 'dpi') };
+    for(const key of Object.keys(options)) {
+        if(options[key] === undefined) {
+            delete options[key];
+        }
+    }
+
+    return options;
+}
+
+function readUserStyle(file) {
+    try {
+        return fs.readFileSync(file, 'utf8');
+    } catch(error) {
+        fail(`cannot read --user-style: ${error.message}`);
+    }
+}
+
+function globToRegExp(pattern) {
+    let source = '';
+    for(let i = 0; i < pattern.length; ++i) {
+        const c = pattern[i];
+        if(c === '*' && pattern[i + 1] === '*') {
+            const slash = pattern[i + 2] === '/';
+            source += slash ? '(?:.*/)?' : '.*';
+            i += slash ? 2 : 1;
+        } else if(c === '*') {
+            source += '[^/]*';
+        } else if(c === '?') {
+            source += '[^/]';
+        } else if(c === '{') {
+            const end = pattern.indexOf('}', i);
+            if(end === -1) {
+                source += '\\{';
+                continue;
+            }
+
+            source += '(?:' + pattern.slice(i + 1, end).split(',').map((part) => part.replace(/[.+^$()|[\]\\]/g, '\\$&')).join('|') + ')';
+            i = end;
+        } else {
+            source += c.replace(/[.+^$()|[\]\\{}]/g, '\\$&');
+        }
+    }
+
+    return new RegExp(`^${source}$`);
+}
+
+function walk(dir, callback) {
+    let entries;
+    try {
+        entries = fs.readdirSync(dir, { withFileTypes: true });
+    } catch {
+        return;
+    }
+
+    for(const entry of entries) {
+        const entryPath = path.join(dir, entry.name);
+        if(entry.isDirectory()) {
+            if(!entry.name.startsWith('.') && entry.name !== 'node_modules')
+                walk(entryPath, callback);
+        } else if(entry.isFile()) {
+            callback(entryPath);
+        }
+    }
+}
+
+function collectInputs(patterns) {
+    const inputs = new Map();
+    const add = (file, base) => {
+        const resolved = path.resolve(file);
+        if(!inputs.has(resolved)) {
+            inputs.set(resolved, path.resolve(base));
+        }
+    };
+
+    for(const pattern of patterns) {
+        if(!/[*?{]/.test(pattern)) {
+            let stat;
+            try {
+                stat = fs.statSync(pattern);
+            } catch {
+                fail(`no such file or directory: ${pattern}`);
+            }
+
+            if(stat.isDirectory()) {
+                walk(pattern, (file) => {
+                    if(INPUT_EXTENSIONS.has(path.extname(file).toLowerCase())) {
+                        add(file, pattern);
+                    }
+                });
+            } else {
+                add(pattern, path.dirname(pattern));
+            }
+
+            continue;
+        }
+
+        const normalized = pattern.split(path.sep).join('/');
+        const segments = normalized.split('/');
+        const wildcard = segments.findIndex((segment) => /[*?{]/.test(segment));
+        const base = segments.slice(0, wildcard).join('/') || '.';
+        const matcher = globToRegExp(segments.slice(wildcard).join('/'));
+        const before = inputs.size;
+        walk(base, (file) => {
+            const relative = path.relative(base, file).split(path.sep).join('/');
+            if(matcher.test(relative)) {
+                add(file, base);
+            }
+        });
+
+        if(inputs.size === before) {
+            console.error(`plutoprint: no inputs match ${pattern}`);
+        }
+    }
+
+    return inputs;
+}
+
+function outputPath(input, base, outputDir, format) {
+    const name = path.basename(input, path.extname(input)) + '.' + format;
+    if(outputDir === undefined)
+        return path.join(path.dirname(input), name);
+    return path.join(path.resolve(outputDir), path.relative(base, path.dirname(input)), name);
+}
+
+function hashFile(file, salt) {
+    return crypto.createHash('sha256').update(salt).update(fs.readFileSync(file)).digest('hex');
+}
+
+function isUpToDate(job, mode, manifest, salt) {
+    let outputStat;
+    try {
+        outputStat = fs.statSync(job.output);
+    } catch {
+        return false;
+    }
+
+    if(mode === 'mtime')
+        return outputStat.mtimeMs >= fs.statSync(job.input).mtimeMs && manifest.salt === salt;
+    job.hash = hashFile(job.input, salt);
+    return manifest.files[job.input] === job.hash;
+}
+
+function formatBytes(bytes) {
+    const units = ['B', 'KiB', 'MiB', 'GiB'];
+    let unit = 0;
+    while(bytes >= 1024 && unit < units.length - 1) {
+        bytes /= 1024;
+        unit++;
+    }
+
+    return `${bytes.toFixed(unit === 0 ? 0 : 1)} ${units[unit]}`;
+}
+
+function main() {
+    let parsed;
+    try {
+        parsed = parseArgs({ options: OPTIONS, allowPositionals: true });
+    } catch(error) {
+        fail(error.message);
+    }
+
+    const { values, positionals } = parsed;
+    if(values.help) {
+        console.log(USAGE);
+        return;
+    }
+
+    if(values.version) {
+        const plutoprint = require('./index');
+        console.log(`plutoprint ${require('./package.json').version} (plutobook ${plutoprint.plutobookVersion})`);
+        return;
+    }
+
+    if(positionals.length === 0)
+        fail('no inputs given; see --help');
+    if(values.format !== 'pdf' && values.format !== 'png')
+        fail(`--format must be pdf or png, got "${values.format}"`);
+    const mode = values.force ? 'off' : values.incremental;
+    if(mode !== 'mtime' && mode !== 'hash' && mode !== 'off')
+        fail(`--incremental must be mtime, hash or off, got "${mode}"`);
+    const jobs = values.jobs === undefined ? (os.availableParallelism ? os.availableParallelism() : os.cpus().length) : Number(values.jobs);
+    if(!Number.isInteger(jobs) || jobs < 1) {
+        fail(`--jobs must be a positive integer, got "${values.jobs}"`);
+    }
+
+    const config = {
+        format: values.format,
+        bookOptions: buildBookOptions(values),
+        userStyle: values['user-style'] && readUserStyle(values['user-style']),
+        pngOptions: buildPngOptions(values)
+    };
+
+    // Workers build their handles from the same options, so any error here
+    // would otherwise fail one job per worker instead of the whole run.
+    const plutoprint = require('./index');
+    try {
+        plutoprint.createBookOptions(config.bookOptions);
+        plutoprint.createPngOptions(config.pngOptions);
+    } catch(error) {
+        fail(error.message);
+    }
+
+    const salt = JSON.stringify(config);
+    const manifestPath = path.join(values.output ? path.resolve(values.output) : process.cwd(), MANIFEST_NAME);
+    let manifest = { salt, files: {} };
+    if(mode !== 'off') {
+        try {
+            manifest = JSON.parse(fs.readFileSync(manifestPath, 'utf8'));
+        } catch {
+        }
+    }
+
+    const queue = [];
+    let skipped = 0;
+    for(const [input, base] of collectInputs(positionals)) {
+        const job = { input, output: outputPath(input, base, values.output, values.format) };
+        if(mode !== 'off' && isUpToDate(job, mode, manifest, salt)) {
+            skipped++;
+            continue;
+        }
+
+        fs.mkdirSync(path.dirname(job.output), { recursive: true });
+        queue.push(job);
+    }
+
+    const total = queue.length;
+    const stats = { converted: 0, failed: 0, pages: 0, bytes: 0 };
+    const files = {};
+    const start = process.hrtime.bigint();
+
+    const finish = () => {
+        const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+        if(mode !== 'off') {
+            manifest.files = Object.assign(manifest.salt === salt ? manifest.files : {}, files);
+            manifest.salt = salt;
+            fs.mkdirSync(path.dirname(manifestPath), { recursive: true });
+            fs.writeFileSync(manifestPath, JSON.stringify(manifest));
+        }
+
+        console.log(`${stats.converted} converted, ${skipped} skipped, ${stats.failed} failed in ${seconds.toFixed(2)}s`
+            + ` (${(stats.converted / seconds || 0).toFixed(1)} files/s, ${(stats.pages / seconds || 0).toFixed(1)} pages/s,`
+            + ` ${formatBytes(stats.bytes)} written, ${Math.min(jobs, total)} workers)`);
+        process.exitCode = stats.failed > 0 ? 1 : 0;
+    };
+
+    if(total === 0) {
+        finish();
+        return;
+    }
+
+    let next = 0;
+    let running = 0;
+    const dispatch = (worker) => {
+        if(next === total) {
+            worker.terminate();
+            return;
+        }
+
+        worker.job = queue[next++];
+        worker.postMessage(worker.job);
+    };
+
+    for(let i = 0; i < Math.min(jobs, total); ++i) {
+        const worker = new Worker(__filename, { workerData: config });
+        running++;
+        worker.on('message', (result) => {
+            const job = worker.job;
+            worker.job = null;
+            if(result.error) {
+                stats.failed++;
+                console.error(`plutoprint: ${path.relative(process.cwd(), job.input)}: ${result.error}`);
+            } else {
+                stats.converted++;
+                stats.pages += result.pages;
+                stats.bytes += result.bytes;
+                if(mode === 'hash')
+                    files[job.input] = job.hash || hashFile(job.input, salt);
+                if(!values.quiet) {
+                    console.log(`${path.relative(process.cwd(), job.output)} (${result.pages} pages, ${result.ms.toFixed(0)} ms)`);
+                }
+            }
+
+            dispatch(worker);
+        });
+
+        worker.on('error', (error) => {
+            if(worker.job)
+                stats.failed++;
+            console.error(`plutoprint: ${worker.job ? path.relative(process.cwd(), worker.job.input) : 'worker'}: ${error.message}`);
+            worker.job = null;
+        });
+
+        worker.on('exit', () => {
+            if(--running > 0)
+                return;
+            if(next < total) {
+                stats.failed += total - next;
+                console.error(`plutoprint: ${total - next} inputs not converted because all workers exited`);
+            }
+
+            finish();
+        });
+
+        dispatch(worker);
+    }
+}
+
+function runWorker() {
+    const plutoprint = require('./index');
+    const { format, bookOptions, userStyle, pngOptions } = workerData;
+    const bookOptionsHandle = plutoprint.createBookOptions(bookOptions);
+    const pngOptionsHandle = plutoprint.createPngOptions(pngOptions);
+
+    parentPort.on('message', (job) => {
+        const start = process.hrtime.bigint();
+        try {
+            const book = plutoprint.createBook(bookOptionsHandle);
+            book.loadUrl(pathToFileURL(job.input).href, userStyle ? { userStyle } : {});
+            if(format === 'pdf') {
+                book.writeToPdf(job.output);
+            } else {
+                book.writeToPng(job.output, pngOptionsHandle);
+            }
+
+            parentPort.postMessage({
+                pages: book.pageCount,
+                bytes: fs.statSync(job.output).size,
+                ms: Number(process.hrtime.bigint() - start) / 1e6
+            });
+        } catch(error) {
+            parentPort.postMessage({ error: error.message });
+        }
+    });
+}
+
+if(isMainThread) {
+    main();
+} else {
+    runWorker();
+}
@@ -12,6 +12,8 @@ export type MediaType = 'print' | 'screen';
 
 export type LengthType = number | string;
 
+export type SyncType = 'none' | 'data' | 'full';
+
 export interface BookOptions {
     size?: SizeType;
     media?: MediaType;
@@ -29,6 +31,15 @@ export interface BookOptions {
     creator?: string;
     creationDate?: Date;
     modificationDate?: Date;
+    resources?: Record<string, Buffer> | Map<string, Buffer> | string;
+    offline?: boolean;
+    maxPages?: number;
+    maxCanvasPixels?: number;
+    maxResourceBytes?: number;
+    maxResourceCount?: number;
+    maxLayoutMs?: number;
+    maxImageDpi?: number;
+    recordSnapshot?: boolean;
 }
 
 export interface LoadOptions {
@@ -36,6 +47,11 @@ export interface LoadOptions {
     userScript?: string;
 }
 
+export interface LoadUrlOptions extends LoadOptions {
+    prefetch?: boolean;
+    prefetchConcurrency?: number;
+}
+
 export interface LoadContentOptions extends LoadOptions {
     baseUrl?: string;
 }
@@ -51,13 +67,74 @@ export interface WritePdfOptions {
     pageStep?: number;
 }
 
+export type PngFilterType = 'none' | 'sub' | 'up' | 'average' | 'paeth' | 'adaptive';
+
+export type PngColorType = 'rgba' | 'rgb' | 'gray' | 'mono';
+
 export interface WritePngOptions {
     width?: number;
     height?: number;
+    scale?: number;
+    dpi?: number;
+    compressionLevel?: number;
+    filter?: PngFilterType;
+    colorType?: PngColorType;
+}
+
+export interface RenderRegionOptions {
+    x?: number;
+    y?: number;
+    width?: number;
+    height?: number;
+    scale?: number;
+    format?: 'png' | 'raw';
+}
+
+export type RenderTarget = ArrayBuffer | NodeJS.TypedArray;
+
+export interface WriteFileOptions {
+    sync?: SyncType;
+    directIo?: boolean;
+    bufferSize?: number;
+}
+
+export interface WritePdfFileOptions extends WritePdfOptions, WriteFileOptions {}
+
+export interface WritePngFileOptions extends WritePngOptions, WriteFileOptions {}
+
+export interface SplitPdfOptions extends WriteFileOptions {
+    ranges?: [number, number][];
+    every?: number;
+    path?: string;
+}
+
+export interface PdfPageEvent {
+    pageIndex: number;
+    byteOffset: number;
+    elapsed: number;
+    data: Buffer;
+}
+
+export interface WritePdfAsyncOptions extends WritePdfOptions {
+    onPage?: (event: PdfPageEvent) => void;
+}
+
+declare const optionsHandle: unique symbol;
+
+export interface BookOptionsHandle {
+    readonly [optionsHandle]: 'BookOptions';
+}
+
+export interface PdfOptionsHandle {
+    readonly [optionsHandle]: 'PdfOptions';
+}
+
+export interface PngOptionsHandle {
+    readonly [optionsHandle]: 'PngOptions';
 }
 
 export class Book {
-    constructor(options?: BookOptions);
+    constructor(options?: BookOptions | BookOptionsHandle);
 
     readonly pageCount: number;
     readonly documentWidth: number;
@@ -65,20 +142,91 @@ export class Book {
     readonly viewportWidth: number;
     readonly viewportHeight: number;
 
-    loadUrl(url: string, options?: LoadOptions): this;
+    loadUrl(url: string, options?: LoadUrlOptions): this;
     loadHtml(content: string, options?: LoadContentOptions): this;
     loadXml(content: string, options?: LoadContentOptions): this;
     loadData(buffer: Buffer, options?: LoadDataOptions): this;
     loadImage(buffer: Buffer, options?: LoadDataOptions): this;
 
-    writeToPdf(path: string, options?: WritePdfOptions): void;
-    writeToPdfBuffer(options?: WritePdfOptions): Buffer;
+    writeToPdf(path: string, options?: WritePdfFileOptions | PdfOptionsHandle): void;
+    writeToPdfBuffer(options?: WritePdfOptions | PdfOptionsHandle): Buffer;
+    writeToPdfInto(target: RenderTarget, options?: WritePdfOptions | PdfOptionsHandle): number;
+    writeToPdfAsync(options?: WritePdfAsyncOptions | PdfOptionsHandle): Promise<Buffer>;
+
+    splitToPdf(options: SplitPdfOptions & { path: string }): string[];
+    splitToPdf(options: SplitPdfOptions): Buffer[];
+
+    writeToPng(path: string, options?: WritePngFileOptions | PngOptionsHandle): void;
+    writeToPngBuffer(options?: WritePngOptions | PngOptionsHandle): Buffer;
+    writeToPngInto(target: RenderTarget, options?: WritePngOptions | PngOptionsHandle): number;
+
+    renderRegion(pageIndex: number, options?: RenderRegionOptions): Buffer;
+    renderRegionInto(target: RenderTarget, pageIndex: number, options?: RenderRegionOptions): number;
 
-    writeToPng(path: string, options?: WritePngOptions): void;
-    writeToPngBuffer(options?: WritePngOptions): Buffer;
+    saveSnapshot(): Buffer;
 }
 
-export function createBook(options?: BookOptions): Book;
+export interface WarmupOptions {
+    fonts?: string[];
+    locales?: string[];
+}
+
+export interface WarmupResult {
+    load: number;
+    render: number;
+    elapsed: number;
+}
+
+export function warmup(options?: WarmupOptions): Promise<WarmupResult>;
+export const warmupReady: Promise<WarmupResult> | undefined;
+
+export interface ResourceCacheStats {
+    capacity: number;
+    size: number;
+    count: number;
+    hits: number;
+    misses: number;
+    evictions: number;
+}
+
+export function setResourceCacheSize(bytes: number): void;
+export function getResourceCacheStats(): ResourceCacheStats;
+export function clearResourceCache(): void;
+
+export function loadSnapshot(source: Buffer | string): Book;
+
+export interface LatencyHistogram {
+    buckets: { le: number; count: number }[];
+    count: number;
+    sum: number;
+}
+
+export interface RenderMetrics {
+    count: number;
+    failures: number;
+    bytes: number;
+}
+
+export interface Metrics {
+    booksCreated: number;
+    booksLive: number;
+    nativeBytes: number;
+    loads: number;
+    loadFailures: number;
+    fetches: number;
+    fetchFailures: number;
+    renders: { pdf: RenderMetrics; png: RenderMetrics; region: RenderMetrics };
+    loadLatency: LatencyHistogram;
+    writeLatency: LatencyHistogram;
+}
+
+export function metrics(): Metrics;
+
+export function createBook(options?: BookOptions | BookOptionsHandle): Book;
+
+export function createBookOptions(options: BookOptions): BookOptionsHandle;
+export function createPdfOptions(options: WritePdfFileOptions): PdfOptionsHandle;
+export function createPngOptions(options: WritePngFileOptions): PngOptionsHandle;
 
 export const plutobookVersion: string;
 export const plutobookBuildInfo: string;
@@ -1 +1,11 @@
 module.exports = require('./build/Release/plutoprint.node');
+
+if(process.env.PLUTOPRINT_WARMUP) {
+    const debug = require('util').debuglog('plutoprint');
+    module.exports.warmupReady = module.exports.warmup();
+    module.exports.warmupReady.then((result) => {
+        debug('warmup finished in %s ms (load %s ms, render %s ms)', result.elapsed.toFixed(1), result.load.toFixed(1), result.render.toFixed(1));
+    }, (error) => {
+        process.emitWarning(`warmup failed: ${error.message}`, 'PlutoprintWarning');
+    });
+}
@@ -13,15 +13,73 @@ expectType<number>(book.viewportWidth);
 expectType<number>(book.viewportHeight);
 
 expectType<plutoprint.Book>(book.loadHtml('<h1>Hello World</h1>'));
+expectType<plutoprint.Book>(book.loadUrl('https://example.com', { prefetch: true, prefetchConcurrency: 16 }));
 
 expectType<void>(book.writeToPdf('hello.pdf'))
+expectType<void>(book.writeToPdf('hello.pdf', { sync: 'full', directIo: true, bufferSize: 4194304 }))
 expectType<Buffer>(book.writeToPdfBuffer())
+expectType<Promise<Buffer>>(book.writeToPdfAsync())
+expectType<Buffer[]>(book.splitToPdf({ every: 1 }))
+expectType<Buffer[]>(book.splitToPdf({ ranges: [[1, 2], [3, 4]] }))
+expectType<string[]>(book.splitToPdf({ every: 2, path: 'part-%d.pdf', sync: 'data' }))
+expectType<Promise<Buffer>>(book.writeToPdfAsync({ pageStart: 2, onPage: (event: plutoprint.PdfPageEvent) => event.data }))
 
 expectType<void>(book.writeToPng('hello.png'))
+expectType<void>(book.writeToPng('hello.png', { width: 320, sync: 'data' }))
 expectType<Buffer>(book.writeToPngBuffer())
+expectType<Buffer>(book.writeToPngBuffer({ width: 320, scale: 2 }))
+expectType<Buffer>(book.writeToPngBuffer({ dpi: 300 }))
+expectType<Buffer>(book.writeToPngBuffer({ compressionLevel: 1, filter: 'none', colorType: 'mono' }))
+
+expectType<Buffer>(book.renderRegion(0))
+expectType<Buffer>(book.renderRegion(0, { x: 100, y: 200, width: 400, height: 300, scale: 2 }))
+expectType<Buffer>(book.renderRegion(0, { width: 400, height: 300, format: 'raw' }))
+
+const target = Buffer.allocUnsafe(1024 * 1024);
+expectType<number>(book.writeToPdfInto(target))
+expectType<number>(book.writeToPngInto(target, { width: 320 }))
+expectType<number>(book.renderRegionInto(new Uint8Array(new SharedArrayBuffer(480000)), 0, { width: 400, height: 300, format: 'raw' }))
+expectType<number>(book.renderRegionInto(new ArrayBuffer(65536), 0))
 
 expectType<plutoprint.Book>(plutoprint.createBook());
 
+expectType<plutoprint.Book>(plutoprint.createBook({ resources: { 'https://example.com/logo.png': Buffer.alloc(0) }, offline: true }));
+expectType<plutoprint.Book>(plutoprint.createBook({ resources: 'assets.tar', offline: true }));
+expectType<plutoprint.Book>(plutoprint.createBook({ resources: new Map([['https://example.com/logo.png', Buffer.alloc(0)]]) }));
+expectType<plutoprint.Book>(plutoprint.createBook({ maxPages: 500, maxCanvasPixels: 50e6, maxResourceBytes: 64e6, maxResourceCount: 200, maxLayoutMs: 10000 }));
+expectType<plutoprint.Book>(plutoprint.createBook({ maxImageDpi: 150 }));
+
+const bookOptions = plutoprint.createBookOptions({ size: 'letter', margin: '1in' });
+expectType<plutoprint.BookOptionsHandle>(bookOptions);
+expectType<plutoprint.Book>(plutoprint.createBook(bookOptions));
+expectType<plutoprint.Book>(new plutoprint.Book(bookOptions));
+
+const pdfOptions = plutoprint.createPdfOptions({ pageStart: 1, pageEnd: 1 });
+expectType<plutoprint.PdfOptionsHandle>(pdfOptions);
+expectType<void>(book.writeToPdf('hello.pdf', pdfOptions));
+expectType<Buffer>(book.writeToPdfBuffer(pdfOptions));
+
+const pngOptions = plutoprint.createPngOptions({ width: 320 });
+expectType<plutoprint.PngOptionsHandle>(pngOptions);
+expectType<void>(book.writeToPng('hello.png', pngOptions));
+expectType<Buffer>(book.writeToPngBuffer(pngOptions));
+
+expectType<Promise<plutoprint.WarmupResult>>(plutoprint.warmup());
+expectType<Promise<plutoprint.WarmupResult>>(plutoprint.warmup({ fonts: ['Noto Sans', 'Noto Serif'], locales: ['en-US', 'de'] }));
+expectType<Promise<plutoprint.WarmupResult> | undefined>(plutoprint.warmupReady);
+
+expectType<void>(plutoprint.setResourceCacheSize(64 * 1024 * 1024));
+expectType<plutoprint.ResourceCacheStats>(plutoprint.getResourceCacheStats());
+expectType<void>(plutoprint.clearResourceCache());
+
+const recorded = plutoprint.createBook({ recordSnapshot: true }).loadHtml('<b>Hello World</b>');
+expectType<Buffer>(recorded.saveSnapshot());
+expectType<plutoprint.Book>(plutoprint.loadSnapshot(recorded.saveSnapshot()));
+expectType<plutoprint.Book>(plutoprint.loadSnapshot('hello.snapshot'));
+
+expectType<plutoprint.Metrics>(plutoprint.metrics());
+expectType<number>(plutoprint.metrics().renders.pdf.bytes);
+
 expectType<string>(plutoprint.plutobookVersion);
 expectType<string>(plutoprint.plutobookBuildInfo);
 
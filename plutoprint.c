@@ -1,10 +1,31 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <node_api.h>
+#include <uv.h>
+#include <zlib.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include <plutobook.h>
 
@@ -101,6 +122,16 @@ static char* get_string_argument(napi_env env, napi_value* argv, size_t argi)
     return result;
 }
 
+static bool get_integer_argument(napi_env env, napi_value* argv, size_t argi, int64_t* result)
+{
+    if(napi_get_value_int64(env, argv[argi], result) == napi_ok) {
+        return true;
+    }
+
+    throw_argument_type_error(env, argv, argi, napi_number);
+    return false;
+}
+
 static bool striequals(const char* a, const char* b)
 {
     while(*a && *b) {
@@ -143,6 +174,56 @@ static bool integer_option_func(napi_env env, napi_value property, const char* n
     return false;
 }
 
+static bool number_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    if(napi_get_value_double(env, property, result) == napi_ok) {
+        return true;
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, property, &type);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` must be number, not %s", name, type_name(type));
+    napi_throw_type_error(env, NULL, msg);
+    return false;
+}
+
+static bool boolean_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    if(napi_get_value_bool(env, property, result) == napi_ok) {
+        return true;
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, property, &type);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` must be boolean, not %s", name, type_name(type));
+    napi_throw_type_error(env, NULL, msg);
+    return false;
+}
+
+static bool function_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    napi_valuetype type;
+    napi_typeof(env, property, &type);
+    if(type == napi_function) {
+        *(napi_value*)result = property;
+        return true;
+    }
+
+    if(type == napi_undefined) {
+        *(napi_value*)result = NULL;
+        return true;
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` must be function, not %s", name, type_name(type));
+    napi_throw_type_error(env, NULL, msg);
+    return false;
+}
+
 static bool media_option_func(napi_env env, napi_value property, const char* name, void* result)
 {
     char* value;
@@ -269,6 +350,42 @@ static bool date_option_func(napi_env env, napi_value property, const char* name
     return false;
 }
 
+typedef enum {
+    FILE_SYNC_NONE,
+    FILE_SYNC_DATA,
+    FILE_SYNC_FULL
+} file_sync_t;
+
+static bool sync_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    char* value;
+    if(!string_option_func(env, property, name, &value))
+        return false;
+    struct {
+        const char* name;
+        file_sync_t value;
+    } table[] = {
+        {"none", FILE_SYNC_NONE},
+        {"data", FILE_SYNC_DATA},
+        {"full", FILE_SYNC_FULL},
+        {NULL}
+    };
+
+    for(int i = 0; table[i].name; ++i) {
+        if(striequals(table[i].name, value)) {
+            *(file_sync_t*)(result) = table[i].value;
+            free(value);
+            return true;
+        }
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` has invalid value \"%s\"", name, value);
+    napi_throw_type_error(env, NULL, msg);
+    free(value);
+    return false;
+}
+
 typedef bool (*option_func_t)(napi_env env, napi_value property, const char* name, void* result);
 
 typedef struct {
@@ -301,270 +418,4963 @@ static bool parse_options(napi_env env, napi_value* argv, size_t argc, size_t ar
     return true;
 }
 
-static napi_ref BookClass_Ref;
-
-static napi_value CreateBook(napi_env env, napi_callback_info info)
+static bool starts_with_ignoring_case(const char* value, size_t length, const char* prefix)
 {
-    size_t argc = 1;
-    napi_value argv[1];
-    if(!get_callback_info(env, info, &argc, argv, NULL, 0, 1)) {
-        return NULL;
+    size_t prefix_length = strlen(prefix);
+    if(length < prefix_length)
+        return false;
+    for(size_t i = 0; i < prefix_length; ++i) {
+        if(tolower((unsigned char)value[i]) != tolower((unsigned char)prefix[i])) {
+            return false;
+        }
     }
 
-    napi_value BookClass;
-    napi_get_reference_value(env, BookClass_Ref, &BookClass);
-
-    napi_value instance;
-    napi_new_instance(env, BookClass, argc, argv, &instance);
-    return instance;
+    return true;
 }
 
-static void BookClass_Finalize(napi_env env, void* data, void* hint)
+typedef struct resource_entry {
+    char* url;
+    plutobook_resource_data_t* data;
+    struct resource_entry* next;
+} resource_entry_t;
+
+typedef struct {
+    resource_entry_t** buckets;
+    size_t bucket_count;
+    size_t count;
+} resource_table_t;
+
+static size_t hash_string(const char* value)
 {
-    plutobook_destroy(data);
+    size_t hash = 2166136261u;
+    while(*value) {
+        hash ^= (unsigned char)(*value++);
+        hash *= 16777619u;
+    }
+
+    return hash;
 }
 
-static void set_date_metadata(plutobook_t* book, plutobook_pdf_metadata_t metadata, double date)
+static void resource_table_init(resource_table_t* table)
 {
-    char value[sizeof("2025-12-11T05:36:01Z")];
-    time_t time = (time_t)(date / 1000);
-    strftime(value, sizeof(value), "%FT%TZ", gmtime(&time));
-    plutobook_set_metadata(book, metadata, value);
+    table->buckets = NULL;
+    table->bucket_count = 0;
+    table->count = 0;
 }
 
-static napi_value BookClass_Constructor(napi_env env, napi_callback_info info)
+static void resource_table_destroy(resource_table_t* table)
 {
-    napi_value new_target;
-    napi_get_new_target(env, info, &new_target);
-    if(new_target == NULL) {
-        return CreateBook(env, info);
+    for(size_t i = 0; i < table->bucket_count; ++i) {
+        resource_entry_t* entry = table->buckets[i];
+        while(entry) {
+            resource_entry_t* next = entry->next;
+            plutobook_resource_data_destroy(entry->data);
+            free(entry->url);
+            free(entry);
+            entry = next;
+        }
     }
 
-    size_t argc = 1;
-    napi_value argv[1];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+    free(table->buckets);
+    resource_table_init(table);
+}
+
+static resource_entry_t* resource_table_lookup(const resource_table_t* table, const char* url)
+{
+    if(table->bucket_count == 0)
         return NULL;
+    resource_entry_t* entry = table->buckets[hash_string(url) & (table->bucket_count - 1)];
+    while(entry) {
+        if(strcmp(entry->url, url) == 0)
+            return entry;
+        entry = entry->next;
     }
 
-    plutobook_page_size_t size = PLUTOBOOK_PAGE_SIZE_A4;
-    plutobook_media_type_t media = PLUTOBOOK_MEDIA_TYPE_PRINT;
-
-    double width = -1;
-    double height = -1;
-
-    double margin = 72;
-    double marginTop = -1;
-    double marginRight = -1;
-    double marginBottom = -1;
-    double marginLeft = -1;
+    return NULL;
+}
 
-    char* title = NULL;
-    char* subject = NULL;
-    char* author = NULL;
-    char* keywords = NULL;
-    char* creator = NULL;
+static plutobook_resource_data_t* resource_table_find(const resource_table_t* table, const char* url)
+{
+    resource_entry_t* entry = resource_table_lookup(table, url);
+    if(entry == NULL)
+        return NULL;
+    return entry->data;
+}
 
-    double creationDate = -1;
-    double modificationDate = -1;
+static bool resource_table_contains(const resource_table_t* table, const char* url)
+{
+    return resource_table_lookup(table, url) != NULL;
+}
 
-    if(argc == 1) {
-        option_t options[] = {
-            {"size", size_option_func, &size},
-            {"media", media_option_func, &media},
-            {"width", length_option_func, &width},
-            {"height", length_option_func, &height},
-            {"margin", length_option_func, &margin},
-            {"marginTop", length_option_func, &marginTop},
-            {"marginRight", length_option_func, &marginRight},
-            {"marginBottom", length_option_func, &marginBottom},
-            {"marginLeft", length_option_func, &marginLeft},
-            {"title", string_option_func, &title},
-            {"subject", string_option_func, &subject},
-            {"author", string_option_func, &author},
-            {"keywords", string_option_func, &keywords},
-            {"creator", string_option_func, &creator},
-            {"creationDate", date_option_func, &creationDate},
-            {"modificationDate", date_option_func, &modificationDate},
-            {NULL}
-        };
+static void resource_table_insert(resource_table_t* table, const char* url, plutobook_resource_data_t* data)
+{
+    resource_entry_t* entry = resource_table_lookup(table, url);
+    if(entry) {
+        plutobook_resource_data_destroy(entry->data);
+        entry->data = data;
+        return;
+    }
 
-        if(!parse_options(env, argv, argc, 0, options)) {
-            thisArg = NULL;
-            goto cleanup;
+    if(table->count >= table->bucket_count) {
+        size_t bucket_count = table->bucket_count == 0 ? 64 : table->bucket_count * 2;
+        resource_entry_t** buckets = calloc(bucket_count, sizeof(resource_entry_t*));
+        for(size_t i = 0; i < table->bucket_count; ++i) {
+            resource_entry_t* entry = table->buckets[i];
+            while(entry) {
+                resource_entry_t* next = entry->next;
+                size_t index = hash_string(entry->url) & (bucket_count - 1);
+                entry->next = buckets[index];
+                buckets[index] = entry;
+                entry = next;
+            }
         }
-    }
 
-    if(width != -1)
-        size.width = width;
-    if(height != -1) {
-        size.height = height;
+        free(table->buckets);
+        table->buckets = buckets;
+        table->bucket_count = bucket_count;
     }
 
-    plutobook_page_margins_t margins = PLUTOBOOK_MAKE_PAGE_MARGINS(margin, margin, margin, margin);
-    if(marginTop != -1)
-        margins.top = marginTop;
-    if(marginRight != -1)
-        margins.right = marginRight;
-    if(marginBottom != -1)
-        margins.bottom = marginBottom;
-    if(marginLeft != -1) {
-        margins.left = marginLeft;
-    }
+    size_t index = hash_string(url) & (table->bucket_count - 1);
+    entry = malloc(sizeof(resource_entry_t));
+    entry->url = strdup(url);
+    entry->data = data;
+    entry->next = table->buckets[index];
+    table->buckets[index] = entry;
+    table->count++;
+}
 
-    plutobook_t* book = plutobook_create(size, margins, media);
-    if(title)
-        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_TITLE, title);
-    if(subject)
-        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_SUBJECT, subject);
-    if(author)
-        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_AUTHOR, author);
-    if(keywords)
-        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_KEYWORDS, keywords);
-    if(creator) {
-        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_CREATOR, creator);
-    }
+#ifdef _WIN32
+static wchar_t* utf8_to_wide(const char* value)
+{
+    int length = MultiByteToWideChar(CP_UTF8, 0, value, -1, NULL, 0);
+    wchar_t* result = malloc(length * sizeof(wchar_t));
+    MultiByteToWideChar(CP_UTF8, 0, value, -1, result, length);
+    return result;
+}
 
-    if(creationDate != -1)
-        set_date_metadata(book, PLUTOBOOK_PDF_METADATA_CREATION_DATE, creationDate);
-    if(modificationDate != -1) {
-        set_date_metadata(book, PLUTOBOOK_PDF_METADATA_MODIFICATION_DATE, modificationDate);
-    }
+#endif
+
+#ifdef _MSC_VER
+#define atomic_increment(value) InterlockedIncrement(value)
+#define atomic_decrement(value) InterlockedDecrement(value)
+#define atomic_add(value, amount) (InterlockedExchangeAdd64(value, amount) + (amount))
+#else
+#define atomic_increment(value) __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST)
+#define atomic_decrement(value) __atomic_sub_fetch(value, 1, __ATOMIC_SEQ_CST)
+#define atomic_add(value, amount) __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST)
+#endif
+
+typedef enum {
+    METRIC_OUTPUT_PDF,
+    METRIC_OUTPUT_PNG,
+    METRIC_OUTPUT_REGION,
+    METRIC_OUTPUT_COUNT
+} metric_output_t;
+
+static const char* metric_output_names[METRIC_OUTPUT_COUNT] = {
+    "pdf",
+    "png",
+    "region"
+};
+
+static const double metric_latency_buckets[] = {
+    1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000
+};
+
+#define METRIC_LATENCY_BUCKET_COUNT (sizeof(metric_latency_buckets) / sizeof(double))
 
-    napi_wrap(env, thisArg, book, BookClass_Finalize, NULL, NULL);
-cleanup:
-    free(title);
-    free(subject);
-    free(author);
-    free(keywords);
-    free(creator);
-    return thisArg;
+typedef struct {
+    volatile int64_t counts[METRIC_LATENCY_BUCKET_COUNT + 1];
+    volatile int64_t sum_us;
+} metric_histogram_t;
+
+typedef struct {
+    volatile int64_t books_created;
+    volatile int64_t books_live;
+    volatile int64_t resource_store_bytes;
+    volatile int64_t loads;
+    volatile int64_t load_failures;
+    volatile int64_t renders[METRIC_OUTPUT_COUNT];
+    volatile int64_t render_failures[METRIC_OUTPUT_COUNT];
+    volatile int64_t bytes_produced[METRIC_OUTPUT_COUNT];
+    volatile int64_t fetches;
+    volatile int64_t fetch_failures;
+    metric_histogram_t load_latency;
+    metric_histogram_t write_latency;
+} metrics_t;
+
+static metrics_t metrics;
+
+static void metric_histogram_observe(metric_histogram_t* histogram, uint64_t start_time)
+{
+    uint64_t elapsed = uv_hrtime() - start_time;
+    double milliseconds = elapsed / 1e6;
+    size_t index = 0;
+    while(index < METRIC_LATENCY_BUCKET_COUNT && milliseconds > metric_latency_buckets[index])
+        ++index;
+    atomic_add(&histogram->counts[index], 1);
+    atomic_add(&histogram->sum_us, (int64_t)(elapsed / 1000));
 }
 
-static napi_value Book_PageCount(napi_env env, napi_callback_info info)
+static void metrics_record_render(metric_output_t output, uint64_t start_time, size_t bytes, bool success)
 {
-    napi_value thisArg;
-    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
-        return NULL;
+    if(!success) {
+        atomic_add(&metrics.render_failures[output], 1);
+        return;
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
-
-    napi_value result;
-    napi_create_uint32(env, plutobook_get_page_count(book), &result);
-    return result;
+    atomic_add(&metrics.renders[output], 1);
+    atomic_add(&metrics.bytes_produced[output], (int64_t)bytes);
+    metric_histogram_observe(&metrics.write_latency, start_time);
 }
 
-static napi_value Book_DocumentWidth(napi_env env, napi_callback_info info)
+typedef struct {
+    resource_table_t table;
+    void* mapping;
+    size_t mapping_size;
+#ifdef _WIN32
+    HANDLE mapping_handle;
+#endif
+    int64_t bytes;
+    volatile long ref_count;
+} resource_store_t;
+
+static resource_store_t* resource_store_create(void)
 {
-    napi_value thisArg;
-    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
-        return NULL;
-    }
+    resource_store_t* store = malloc(sizeof(resource_store_t));
+    resource_table_init(&store->table);
+    store->mapping = NULL;
+    store->mapping_size = 0;
+#ifdef _WIN32
+    store->mapping_handle = NULL;
+#endif
+    store->bytes = 0;
+    store->ref_count = 1;
+    return store;
+}
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+static resource_store_t* resource_store_reference(resource_store_t* store)
+{
+    if(store)
+        atomic_increment(&store->ref_count);
+    return store;
+}
 
-    napi_value result;
-    napi_create_double(env, plutobook_get_document_width(book), &result);
-    return result;
+static void resource_store_account(resource_store_t* store, size_t bytes)
+{
+    store->bytes += bytes;
+    atomic_add(&metrics.resource_store_bytes, (int64_t)bytes);
 }
 
-static napi_value Book_DocumentHeight(napi_env env, napi_callback_info info)
+static void resource_store_release(void* data)
 {
-    napi_value thisArg;
-    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
-        return NULL;
+    resource_store_t* store = data;
+    if(store == NULL || atomic_decrement(&store->ref_count) > 0)
+        return;
+    atomic_add(&metrics.resource_store_bytes, -store->bytes);
+    resource_table_destroy(&store->table);
+#ifdef _WIN32
+    if(store->mapping)
+        UnmapViewOfFile(store->mapping);
+    if(store->mapping_handle)
+        CloseHandle(store->mapping_handle);
+#else
+    if(store->mapping) {
+        munmap(store->mapping, store->mapping_size);
     }
+#endif
+    free(store);
+}
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+static plutobook_resource_data_t* resource_store_find(resource_store_t* store, const char* url)
+{
+    plutobook_resource_data_t* resource = resource_table_find(&store->table, url);
+    if(resource == NULL) {
+        const char* scheme_end = strstr(url, "://");
+        if(scheme_end == NULL)
+            return NULL;
+        const char* key = scheme_end + 3;
+        while(*key == '/')
+            ++key;
+        resource = resource_table_find(&store->table, key);
+        if(resource == NULL) {
+            return NULL;
+        }
+    }
 
-    napi_value result;
-    napi_create_double(env, plutobook_get_document_height(book), &result);
-    return result;
+    resource_store_reference(store);
+    return plutobook_resource_data_create_without_copy(plutobook_resource_data_get_content(resource), plutobook_resource_data_get_content_length(resource),
+        plutobook_resource_data_get_mime_type(resource), plutobook_resource_data_get_text_encoding(resource), resource_store_release, store);
 }
 
-static napi_value Book_ViewportWidth(napi_env env, napi_callback_info info)
+static const char* guess_mime_type(const char* name)
 {
-    napi_value thisArg;
-    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
-        return NULL;
-    }
+    static const struct {
+        const char* extension;
+        const char* mime_type;
+    } table[] = {
+        {".html", "text/html"},
+        {".htm", "text/html"},
+        {".xhtml", "application/xhtml+xml"},
+        {".xml", "text/xml"},
+        {".svg", "image/svg+xml"},
+        {".css", "text/css"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".bmp", "image/bmp"},
+        {".ico", "image/x-icon"},
+        {".ttf", "font/ttf"},
+        {".otf", "font/otf"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+        {NULL}
+    };
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    size_t length = strcspn(name, "?#");
+    for(int i = 0; table[i].extension; ++i) {
+        size_t extension_length = strlen(table[i].extension);
+        if(length > extension_length && starts_with_ignoring_case(name + length - extension_length, extension_length, table[i].extension)) {
+            return table[i].mime_type;
+        }
+    }
 
-    napi_value result;
-    napi_create_double(env, plutobook_get_viewport_width(book), &result);
-    return result;
+    return "";
 }
 
-static napi_value Book_ViewportHeight(napi_env env, napi_callback_info info)
+static void resource_store_add(resource_store_t* store, const char* key, const char* content, size_t length, bool copy)
 {
-    napi_value thisArg;
-    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
-        return NULL;
+    while(key[0] == '.' && key[1] == '/')
+        key += 2;
+    const char* mime_type = guess_mime_type(key);
+    plutobook_resource_data_t* resource;
+    if(copy) {
+        resource = plutobook_resource_data_create(content, length, mime_type, "");
+        resource_store_account(store, length);
+    } else {
+        resource = plutobook_resource_data_create_without_copy(content, length, mime_type, "", NULL, NULL);
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    resource_table_insert(&store->table, key, resource);
+}
 
-    napi_value result;
-    napi_create_double(env, plutobook_get_viewport_height(book), &result);
+static char* copy_string(const char* data, size_t length)
+{
+    size_t size = strnlen(data, length);
+    char* result = malloc(size + 1);
+    if(result == NULL)
+        return NULL;
+    memcpy(result, data, size);
+    result[size] = '\0';
     return result;
 }
 
-static napi_value Book_LoadUrl(napi_env env, napi_callback_info info)
+static size_t parse_tar_number(const char* data, size_t length)
 {
-    size_t argc = 2;
-    napi_value argv[2];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
-        return NULL;
-    }
+    size_t value = 0;
+    for(size_t i = 0; i < length && data[i] >= '0' && data[i] <= '7'; ++i)
+        value = value * 8 + (data[i] - '0');
+    return value;
+}
 
-    char* url = get_string_argument(env, argv, 0);
-    if(url == NULL) {
-        return NULL;
+static char* parse_pax_path(const char* data, size_t length)
+{
+    const char* end = data + length;
+    while(data < end) {
+        size_t record_length = 0;
+        const char* cursor = data;
+        while(cursor < end && *cursor >= '0' && *cursor <= '9') {
+            if(record_length > (size_t)(end - data) / 10)
+                return NULL;
+            record_length = record_length * 10 + (*cursor++ - '0');
+        }
+
+        if(cursor == data || cursor == end || *cursor != ' ' || record_length > (size_t)(end - data))
+            return NULL;
+        const char* keyword = cursor + 1;
+        const char* record_end = data + record_length;
+        if(keyword >= record_end || record_end[-1] != '\n')
+            return NULL;
+        if(keyword + 6 <= record_end && memcmp(keyword, "path=", 5) == 0)
+            return copy_string(keyword + 5, record_end - keyword - 6);
+        data = record_end;
     }
 
-    char* userStyle = NULL;
-    char* userScript = NULL;
+    return NULL;
+}
 
-    if(argc == 2) {
-        option_t options[] = {
-            {"userStyle", string_option_func, &userStyle},
-            {"userScript", string_option_func, &userScript},
-            {NULL}
-        };
+static bool resource_store_index_tar(resource_store_t* store, const char* data, size_t size)
+{
+    char* long_name = NULL;
+    size_t offset = 0;
+    while(offset + 512 <= size) {
+        const char* header = data + offset;
+        if(header[0] == '\0')
+            break;
+        size_t entry_size = parse_tar_number(header + 124, 12);
+        char type = header[156];
+        offset += 512;
+        if(entry_size > size - offset) {
+            free(long_name);
+            return false;
+        }
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            thisArg = NULL;
-            goto cleanup;
+        if(type == 'L' || type == 'x') {
+            free(long_name);
+            long_name = type == 'L' ? copy_string(data + offset, entry_size) : parse_pax_path(data + offset, entry_size);
+        } else if(type == '0' || type == '\0') {
+            char name[257];
+            if(memcmp(header + 257, "ustar", 5) == 0 && header[345]) {
+                snprintf(name, sizeof(name), "%.155s/%.100s", header + 345, header);
+            } else {
+                snprintf(name, sizeof(name), "%.100s", header);
+            }
+
+            resource_store_add(store, long_name ? long_name : name, data + offset, entry_size, false);
+            free(long_name);
+            long_name = NULL;
         }
+
+        offset += (entry_size + 511) & ~(size_t)511;
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    free(long_name);
+    return true;
+}
 
+static bool resource_store_map_file(resource_store_t* store, const char* path)
+{
+#ifdef _WIN32
+    wchar_t* wpath = utf8_to_wide(path);
+    HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    free(wpath);
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    store->mapping_size = (size_t)size.QuadPart;
+    if(store->mapping_size > 0) {
+        store->mapping_handle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(store->mapping_handle) {
+            store->mapping = MapViewOfFile(store->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+        }
+    }
+
+    CloseHandle(file);
+    if(store->mapping)
+        resource_store_account(store, store->mapping_size);
+    return store->mapping_size == 0 || store->mapping;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+
+    store->mapping_size = st.st_size;
+    if(store->mapping_size > 0) {
+        void* mapping = mmap(NULL, store->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED) {
+            store->mapping = mapping;
+        }
+    }
+
+    close(fd);
+    if(store->mapping)
+        resource_store_account(store, store->mapping_size);
+    return store->mapping_size == 0 || store->mapping;
+#endif
+}
+
+static bool resources_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    char msg[512];
+    napi_valuetype type;
+    napi_typeof(env, property, &type);
+    if(type == napi_string) {
+        char* path;
+        get_string_value(env, property, &path);
+        resource_store_t* store = resource_store_create();
+        if(!resource_store_map_file(store, path)) {
+            snprintf(msg, sizeof(msg), "Property `%s` could not open \"%s\": %s", name, path, strerror(errno));
+            napi_throw_error(env, NULL, msg);
+            resource_store_release(store);
+            free(path);
+            return false;
+        }
+
+        if(!resource_store_index_tar(store, store->mapping, store->mapping_size)) {
+            snprintf(msg, sizeof(msg), "Property `%s` is not a valid tar bundle: \"%s\"", name, path);
+            napi_throw_error(env, NULL, msg);
+            resource_store_release(store);
+            free(path);
+            return false;
+        }
+
+        resource_store_release(*(resource_store_t**)(result));
+        *(resource_store_t**)(result) = store;
+        free(path);
+        return true;
+    }
+
+    napi_value global, Object, Map, Array;
+    napi_get_global(env, &global);
+    napi_get_named_property(env, global, "Object", &Object);
+    napi_get_named_property(env, global, "Map", &Map);
+    napi_get_named_property(env, global, "Array", &Array);
+
+    bool is_map = false;
+    bool is_plain = false;
+    if(type == napi_object) {
+        napi_instanceof(env, property, Map, &is_map);
+        if(!is_map) {
+            napi_value prototype, object_prototype;
+            napi_get_prototype(env, property, &prototype);
+            napi_get_named_property(env, Object, "prototype", &object_prototype);
+            napi_valuetype prototype_type;
+            napi_typeof(env, prototype, &prototype_type);
+            napi_strict_equals(env, prototype, object_prototype, &is_plain);
+            is_plain = is_plain || prototype_type == napi_null;
+        }
+    }
+
+    if(!is_map && !is_plain) {
+        snprintf(msg, sizeof(msg), "Property `%s` must be string, plain object or Map, not %s", name, type == napi_object ? "other object" : type_name(type));
+        napi_throw_type_error(env, NULL, msg);
+        return false;
+    }
+
+    napi_value entries;
+    if(is_map) {
+        napi_value from;
+        napi_get_named_property(env, Array, "from", &from);
+        if(napi_call_function(env, Array, from, 1, &property, &entries) != napi_ok) {
+            return false;
+        }
+    } else {
+        napi_value func;
+        napi_get_named_property(env, Object, "entries", &func);
+        if(napi_call_function(env, Object, func, 1, &property, &entries) != napi_ok) {
+            return false;
+        }
+    }
+
+    uint32_t entry_count;
+    napi_get_array_length(env, entries, &entry_count);
+
+    resource_store_t* store = resource_store_create();
+    for(uint32_t i = 0; i < entry_count; ++i) {
+        napi_value entry, key, value;
+        napi_get_element(env, entries, i, &entry);
+        napi_get_element(env, entry, 0, &key);
+        napi_get_element(env, entry, 1, &value);
+
+        napi_typeof(env, key, &type);
+        if(type != napi_string) {
+            snprintf(msg, sizeof(msg), "Property `%s` keys must be string, not %s", name, type_name(type));
+            napi_throw_type_error(env, NULL, msg);
+            resource_store_release(store);
+            return false;
+        }
+
+        char* url;
+        get_string_value(env, key, &url);
+
+        void* data;
+        size_t length;
+        if(napi_get_buffer_info(env, value, &data, &length) != napi_ok) {
+            napi_typeof(env, value, &type);
+            snprintf(msg, sizeof(msg), "Property `%s[\"%.200s\"]` must be buffer, not %s", name, url, type_name(type));
+            napi_throw_type_error(env, NULL, msg);
+            resource_store_release(store);
+            free(url);
+            return false;
+        }
+
+        resource_store_add(store, url, data, length, true);
+        free(url);
+    }
+
+    resource_store_release(*(resource_store_t**)(result));
+    *(resource_store_t**)(result) = store;
+    return true;
+}
+
+#define FILE_STREAM_DEFAULT_BUFFER_SIZE (1024 * 1024)
+#define FILE_STREAM_MIN_BUFFER_SIZE 4096
+#define FILE_STREAM_MAX_BUFFER_SIZE (256 * 1024 * 1024)
+
+typedef struct {
+    file_sync_t sync;
+    bool directIo;
+    int64_t bufferSize;
+} file_options_t;
+
+static void file_options_init(file_options_t* options)
+{
+    options->sync = FILE_SYNC_NONE;
+    options->directIo = false;
+    options->bufferSize = FILE_STREAM_DEFAULT_BUFFER_SIZE;
+}
+
+static bool buffer_size_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    if(!integer_option_func(env, property, name, result))
+        return false;
+    int64_t value = *(int64_t*)(result);
+    if(value < FILE_STREAM_MIN_BUFFER_SIZE || value > FILE_STREAM_MAX_BUFFER_SIZE) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Property `%s` must be between %d and %d", name, FILE_STREAM_MIN_BUFFER_SIZE, FILE_STREAM_MAX_BUFFER_SIZE);
+        napi_throw_range_error(env, NULL, msg);
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_file_options(napi_env env, napi_value* argv, size_t argc, size_t argi, file_options_t* file_options)
+{
+    option_t options[] = {
+        {"sync", sync_option_func, &file_options->sync},
+        {"directIo", boolean_option_func, &file_options->directIo},
+        {"bufferSize", buffer_size_option_func, &file_options->bufferSize},
+        {NULL}
+    };
+
+    return parse_options(env, argv, argc, argi, options);
+}
+
+typedef enum {
+    BOOK_LIMIT_MAX_PAGES,
+    BOOK_LIMIT_MAX_CANVAS_PIXELS,
+    BOOK_LIMIT_MAX_RESOURCE_BYTES,
+    BOOK_LIMIT_MAX_RESOURCE_COUNT,
+    BOOK_LIMIT_MAX_LAYOUT_MS,
+    BOOK_LIMIT_COUNT
+} book_limit_t;
+
+static const char* book_limit_names[BOOK_LIMIT_COUNT] = {
+    "maxPages",
+    "maxCanvasPixels",
+    "maxResourceBytes",
+    "maxResourceCount",
+    "maxLayoutMs"
+};
+
+typedef struct {
+    plutobook_page_size_t size;
+    plutobook_page_margins_t margins;
+    plutobook_media_type_t media;
+    char* title;
+    char* subject;
+    char* author;
+    char* keywords;
+    char* creator;
+    double creationDate;
+    double modificationDate;
+    resource_store_t* resources;
+    bool offline;
+    int64_t limits[BOOK_LIMIT_COUNT];
+    double maxImageDpi;
+    bool recordSnapshot;
+} book_options_t;
+
+static void book_options_init(book_options_t* options)
+{
+    options->size = PLUTOBOOK_PAGE_SIZE_A4;
+    options->margins = PLUTOBOOK_MAKE_PAGE_MARGINS(72, 72, 72, 72);
+    options->media = PLUTOBOOK_MEDIA_TYPE_PRINT;
+    options->title = NULL;
+    options->subject = NULL;
+    options->author = NULL;
+    options->keywords = NULL;
+    options->creator = NULL;
+    options->creationDate = -1;
+    options->modificationDate = -1;
+    options->resources = NULL;
+    options->offline = false;
+    for(int i = 0; i < BOOK_LIMIT_COUNT; ++i) {
+        options->limits[i] = 0;
+    }
+
+    options->maxImageDpi = 0;
+    options->recordSnapshot = false;
+}
+
+static void book_options_destroy(book_options_t* options)
+{
+    free(options->title);
+    free(options->subject);
+    free(options->author);
+    free(options->keywords);
+    free(options->creator);
+    resource_store_release(options->resources);
+}
+
+static bool parse_book_options(napi_env env, napi_value* argv, size_t argc, size_t argi, book_options_t* book_options)
+{
+    double width = -1;
+    double height = -1;
+
+    double margin = 72;
+    double marginTop = -1;
+    double marginRight = -1;
+    double marginBottom = -1;
+    double marginLeft = -1;
+
+    option_t options[] = {
+        {"size", size_option_func, &book_options->size},
+        {"media", media_option_func, &book_options->media},
+        {"width", length_option_func, &width},
+        {"height", length_option_func, &height},
+        {"margin", length_option_func, &margin},
+        {"marginTop", length_option_func, &marginTop},
+        {"marginRight", length_option_func, &marginRight},
+        {"marginBottom", length_option_func, &marginBottom},
+        {"marginLeft", length_option_func, &marginLeft},
+        {"title", string_option_func, &book_options->title},
+        {"subject", string_option_func, &book_options->subject},
+        {"author", string_option_func, &book_options->author},
+        {"keywords", string_option_func, &book_options->keywords},
+        {"creator", string_option_func, &book_options->creator},
+        {"creationDate", date_option_func, &book_options->creationDate},
+        {"modificationDate", date_option_func, &book_options->modificationDate},
+        {"resources", resources_option_func, &book_options->resources},
+        {"offline", boolean_option_func, &book_options->offline},
+        {"maxPages", integer_option_func, &book_options->limits[BOOK_LIMIT_MAX_PAGES]},
+        {"maxCanvasPixels", integer_option_func, &book_options->limits[BOOK_LIMIT_MAX_CANVAS_PIXELS]},
+        {"maxResourceBytes", integer_option_func, &book_options->limits[BOOK_LIMIT_MAX_RESOURCE_BYTES]},
+        {"maxResourceCount", integer_option_func, &book_options->limits[BOOK_LIMIT_MAX_RESOURCE_COUNT]},
+        {"maxLayoutMs", integer_option_func, &book_options->limits[BOOK_LIMIT_MAX_LAYOUT_MS]},
+        {"maxImageDpi", number_option_func, &book_options->maxImageDpi},
+        {"recordSnapshot", boolean_option_func, &book_options->recordSnapshot},
+        {NULL}
+    };
+
+    if(!parse_options(env, argv, argc, argi, options)) {
+        return false;
+    }
+
+    for(int i = 0; i < BOOK_LIMIT_COUNT; ++i) {
+        if(book_options->limits[i] < 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Property `%s` must not be negative", book_limit_names[i]);
+            napi_throw_range_error(env, NULL, msg);
+            return false;
+        }
+    }
+
+    if(book_options->maxImageDpi < 0) {
+        napi_throw_range_error(env, NULL, "Property `maxImageDpi` must not be negative");
+        return false;
+    }
+
+    if(width != -1)
+        book_options->size.width = width;
+    if(height != -1) {
+        book_options->size.height = height;
+    }
+
+    plutobook_page_margins_t margins = PLUTOBOOK_MAKE_PAGE_MARGINS(margin, margin, margin, margin);
+    if(marginTop != -1)
+        margins.top = marginTop;
+    if(marginRight != -1)
+        margins.right = marginRight;
+    if(marginBottom != -1)
+        margins.bottom = marginBottom;
+    if(marginLeft != -1) {
+        margins.left = marginLeft;
+    }
+
+    book_options->margins = margins;
+    return true;
+}
+
+typedef struct {
+    int64_t pageStart;
+    int64_t pageEnd;
+    int64_t pageStep;
+    file_options_t file;
+} pdf_options_t;
+
+static void pdf_options_init(pdf_options_t* options)
+{
+    options->pageStart = PLUTOBOOK_MIN_PAGE_COUNT;
+    options->pageEnd = PLUTOBOOK_MAX_PAGE_COUNT;
+    options->pageStep = 1;
+    file_options_init(&options->file);
+}
+
+static bool parse_pdf_options(napi_env env, napi_value* argv, size_t argc, size_t argi, pdf_options_t* pdf_options)
+{
+    option_t options[] = {
+        {"pageStart", integer_option_func, &pdf_options->pageStart},
+        {"pageEnd", integer_option_func, &pdf_options->pageEnd},
+        {"pageStep", integer_option_func, &pdf_options->pageStep},
+        {NULL}
+    };
+
+    return parse_options(env, argv, argc, argi, options);
+}
+
+typedef enum {
+    PNG_FILTER_DEFAULT = -1,
+    PNG_FILTER_NONE,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH,
+    PNG_FILTER_ADAPTIVE
+} png_filter_t;
+
+static bool png_filter_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    char* value;
+    if(!string_option_func(env, property, name, &value))
+        return false;
+    struct {
+        const char* name;
+        png_filter_t value;
+    } table[] = {
+        {"none", PNG_FILTER_NONE},
+        {"sub", PNG_FILTER_SUB},
+        {"up", PNG_FILTER_UP},
+        {"average", PNG_FILTER_AVERAGE},
+        {"paeth", PNG_FILTER_PAETH},
+        {"adaptive", PNG_FILTER_ADAPTIVE},
+        {NULL}
+    };
+
+    for(int i = 0; table[i].name; ++i) {
+        if(striequals(table[i].name, value)) {
+            *(png_filter_t*)(result) = table[i].value;
+            free(value);
+            return true;
+        }
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` has invalid value \"%s\"", name, value);
+    napi_throw_type_error(env, NULL, msg);
+    free(value);
+    return false;
+}
+
+typedef enum {
+    PNG_COLOR_DEFAULT = -1,
+    PNG_COLOR_RGBA,
+    PNG_COLOR_RGB,
+    PNG_COLOR_GRAY,
+    PNG_COLOR_MONO
+} png_color_t;
+
+static bool png_color_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    char* value;
+    if(!string_option_func(env, property, name, &value))
+        return false;
+    struct {
+        const char* name;
+        png_color_t value;
+    } table[] = {
+        {"rgba", PNG_COLOR_RGBA},
+        {"rgb", PNG_COLOR_RGB},
+        {"gray", PNG_COLOR_GRAY},
+        {"mono", PNG_COLOR_MONO},
+        {NULL}
+    };
+
+    for(int i = 0; table[i].name; ++i) {
+        if(striequals(table[i].name, value)) {
+            *(png_color_t*)(result) = table[i].value;
+            free(value);
+            return true;
+        }
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` has invalid value \"%s\"", name, value);
+    napi_throw_type_error(env, NULL, msg);
+    free(value);
+    return false;
+}
+
+typedef struct {
+    int64_t width;
+    int64_t height;
+    double scale;
+    int64_t compressionLevel;
+    png_filter_t filter;
+    png_color_t colorType;
+    file_options_t file;
+} png_options_t;
+
+static void png_options_init(png_options_t* options)
+{
+    options->width = -1;
+    options->height = -1;
+    options->scale = 1;
+    options->compressionLevel = -1;
+    options->filter = PNG_FILTER_DEFAULT;
+    options->colorType = PNG_COLOR_DEFAULT;
+    file_options_init(&options->file);
+}
+
+static bool parse_png_options(napi_env env, napi_value* argv, size_t argc, size_t argi, png_options_t* png_options)
+{
+    double dpi = -1;
+    option_t options[] = {
+        {"width", integer_option_func, &png_options->width},
+        {"height", integer_option_func, &png_options->height},
+        {"scale", number_option_func, &png_options->scale},
+        {"dpi", number_option_func, &dpi},
+        {"compressionLevel", integer_option_func, &png_options->compressionLevel},
+        {"filter", png_filter_option_func, &png_options->filter},
+        {"colorType", png_color_option_func, &png_options->colorType},
+        {NULL}
+    };
+
+    if(!parse_options(env, argv, argc, argi, options)) {
+        return false;
+    }
+
+    if(dpi != -1) {
+        if(!(dpi > 0)) {
+            napi_throw_range_error(env, NULL, "Property `dpi` must be greater than 0");
+            return false;
+        }
+
+        png_options->scale *= dpi / 96.0;
+    }
+
+    if(!(png_options->scale > 0)) {
+        napi_throw_range_error(env, NULL, "Property `scale` must be greater than 0");
+        return false;
+    }
+
+    if(png_options->compressionLevel != -1 && (png_options->compressionLevel < 0 || png_options->compressionLevel > 9)) {
+        napi_throw_range_error(env, NULL, "Property `compressionLevel` must be between 0 and 9");
+        return false;
+    }
+
+    return true;
+}
+
+typedef struct {
+    napi_ref BookClass_Ref;
+    napi_ref BookOptionsClass_Ref;
+    napi_ref PdfOptionsClass_Ref;
+    napi_ref PngOptionsClass_Ref;
+} instance_data_t;
+
+static instance_data_t* get_instance_data(napi_env env)
+{
+    instance_data_t* data = NULL;
+    napi_get_instance_data(env, (void**)&data);
+    return data;
+}
+
+static void InstanceData_Finalize(napi_env env, void* data, void* hint)
+{
+    instance_data_t* instance_data = data;
+    napi_delete_reference(env, instance_data->BookClass_Ref);
+    napi_delete_reference(env, instance_data->BookOptionsClass_Ref);
+    napi_delete_reference(env, instance_data->PdfOptionsClass_Ref);
+    napi_delete_reference(env, instance_data->PngOptionsClass_Ref);
+    free(instance_data);
+}
+
+static bool is_options_handle(napi_env env, napi_value value, napi_ref class_ref)
+{
+    napi_value OptionsClass;
+    napi_get_reference_value(env, class_ref, &OptionsClass);
+
+    bool is_instance = false;
+    if(napi_instanceof(env, value, OptionsClass, &is_instance) != napi_ok)
+        return false;
+    return is_instance;
+}
+
+static bool get_options_handle(napi_env env, napi_value* argv, size_t argi, napi_ref class_ref, const char* class_name, void** handle)
+{
+    *handle = NULL;
+    if(is_options_handle(env, argv[argi], class_ref)) {
+        napi_unwrap(env, argv[argi], handle);
+        return true;
+    }
+
+    instance_data_t* instance_data = get_instance_data(env);
+    const struct {
+        napi_ref class_ref;
+        const char* class_name;
+    } classes[] = {
+        {instance_data->BookOptionsClass_Ref, "BookOptions"},
+        {instance_data->PdfOptionsClass_Ref, "PdfOptions"},
+        {instance_data->PngOptionsClass_Ref, "PngOptions"}
+    };
+
+    for(size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); ++i) {
+        if(is_options_handle(env, argv[argi], classes[i].class_ref)) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Argument %zu must be a %s, not a %s", argi + 1, class_name, classes[i].class_name);
+            napi_throw_type_error(env, NULL, msg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static napi_value create_options_handle(napi_env env, napi_ref class_ref, void* options, napi_finalize finalize)
+{
+    napi_value OptionsClass;
+    napi_get_reference_value(env, class_ref, &OptionsClass);
+
+    napi_value instance;
+    napi_new_instance(env, OptionsClass, 0, NULL, &instance);
+    napi_wrap(env, instance, options, finalize, NULL, NULL);
+
+    napi_value global, Object, freeze;
+    napi_get_global(env, &global);
+    napi_get_named_property(env, global, "Object", &Object);
+    napi_get_named_property(env, Object, "freeze", &freeze);
+    napi_call_function(env, Object, freeze, 1, &instance, NULL);
+    return instance;
+}
+
+static const book_options_t* get_book_options(napi_env env, napi_value* argv, size_t argc, size_t argi, book_options_t* options)
+{
+    void* handle;
+    if(!get_options_handle(env, argv, argi, get_instance_data(env)->BookOptionsClass_Ref, "BookOptions", &handle))
+        return NULL;
+    if(handle)
+        return handle;
+    if(!parse_book_options(env, argv, argc, argi, options))
+        return NULL;
+    return options;
+}
+
+static const pdf_options_t* get_pdf_options(napi_env env, napi_value* argv, size_t argc, size_t argi, pdf_options_t* options, bool file)
+{
+    void* handle;
+    if(!get_options_handle(env, argv, argi, get_instance_data(env)->PdfOptionsClass_Ref, "PdfOptions", &handle))
+        return NULL;
+    if(handle)
+        return handle;
+    if(!parse_pdf_options(env, argv, argc, argi, options))
+        return NULL;
+    if(file && !parse_file_options(env, argv, argc, argi, &options->file))
+        return NULL;
+    return options;
+}
+
+static const png_options_t* get_png_options(napi_env env, napi_value* argv, size_t argc, size_t argi, png_options_t* options, bool file)
+{
+    void* handle;
+    if(!get_options_handle(env, argv, argi, get_instance_data(env)->PngOptionsClass_Ref, "PngOptions", &handle))
+        return NULL;
+    if(handle)
+        return handle;
+    if(!parse_png_options(env, argv, argc, argi, options))
+        return NULL;
+    if(file && !parse_file_options(env, argv, argc, argi, &options->file))
+        return NULL;
+    return options;
+}
+
+static void BookOptions_Finalize(napi_env env, void* data, void* hint)
+{
+    book_options_destroy(data);
+    free(data);
+}
+
+static void Options_Finalize(napi_env env, void* data, void* hint)
+{
+    free(data);
+}
+
+static napi_value CreateBookOptions(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 1, 0)) {
+        return NULL;
+    }
+
+    book_options_t* options = malloc(sizeof(book_options_t));
+    book_options_init(options);
+    if(!parse_book_options(env, argv, argc, 0, options)) {
+        book_options_destroy(options);
+        free(options);
+        return NULL;
+    }
+
+    return create_options_handle(env, get_instance_data(env)->BookOptionsClass_Ref, options, BookOptions_Finalize);
+}
+
+static napi_value CreatePdfOptions(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 1, 0)) {
+        return NULL;
+    }
+
+    pdf_options_t* options = malloc(sizeof(pdf_options_t));
+    pdf_options_init(options);
+    if(!parse_pdf_options(env, argv, argc, 0, options) || !parse_file_options(env, argv, argc, 0, &options->file)) {
+        free(options);
+        return NULL;
+    }
+
+    return create_options_handle(env, get_instance_data(env)->PdfOptionsClass_Ref, options, Options_Finalize);
+}
+
+static napi_value CreatePngOptions(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 1, 0)) {
+        return NULL;
+    }
+
+    png_options_t* options = malloc(sizeof(png_options_t));
+    png_options_init(options);
+    if(!parse_png_options(env, argv, argc, 0, options) || !parse_file_options(env, argv, argc, 0, &options->file)) {
+        free(options);
+        return NULL;
+    }
+
+    return create_options_handle(env, get_instance_data(env)->PngOptionsClass_Ref, options, Options_Finalize);
+}
+
+static napi_value OptionsClass_Constructor(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    napi_get_cb_info(env, info, NULL, NULL, &thisArg, NULL);
+    return thisArg;
+}
+
+static void OptionsClass_Init(napi_env env, const char* name, napi_ref* class_ref)
+{
+    napi_value OptionsClass;
+    napi_define_class(env, name, NAPI_AUTO_LENGTH, OptionsClass_Constructor, NULL, 0, NULL, &OptionsClass);
+    napi_create_reference(env, OptionsClass, 1, class_ref);
+}
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} memory_stream_t;
+
+static void memory_stream_init(memory_stream_t* stream)
+{
+    stream->data = NULL;
+    stream->size = 0;
+    stream->capacity = 0;
+}
+
+static void memory_stream_destroy(memory_stream_t* stream)
+{
+    free(stream->data);
+}
+
+static plutobook_stream_status_t stream_write_func(void* closure, const char* data, unsigned int length)
+{
+    memory_stream_t* stream = closure;
+
+    size_t required_capacity = stream->size + length;
+    if(required_capacity > stream->capacity) {
+        size_t new_capacity = stream->capacity == 0 ? 128 : stream->capacity;
+        while(new_capacity < required_capacity) {
+            new_capacity *= 2;
+        }
+
+        char* new_data = realloc(stream->data, new_capacity);
+        if(new_data == NULL)
+            return PLUTOBOOK_STREAM_STATUS_WRITE_ERROR;
+        stream->data = new_data;
+        stream->capacity = new_capacity;
+    }
+
+    memcpy(stream->data + stream->size, data, length);
+    stream->size += length;
+    return PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+typedef struct {
+    double document_width;
+    double document_height;
+    double canvas_width;
+    double canvas_height;
+} image_size_t;
+
+static bool get_document_image_size(const plutobook_t* book, int64_t width, int64_t height, double scale, image_size_t* size)
+{
+    double document_width = ceil(plutobook_get_document_width(book));
+    double document_height = ceil(plutobook_get_document_height(book));
+    if(document_width <= 0 || document_height <= 0) {
+        plutobook_set_error_message("Invalid document size");
+        return false;
+    }
+
+    if(width <= 0 && height <= 0) {
+        width = document_width;
+        height = document_height;
+    } else if(height <= 0) {
+        height = width * document_height / document_width;
+    } else if(width <= 0) {
+        width = height * document_width / document_height;
+    }
+
+    double canvas_width = ceil(width * scale);
+    double canvas_height = ceil(height * scale);
+    if(canvas_width < 1 || canvas_height < 1 || canvas_width > INT_MAX || canvas_height > INT_MAX) {
+        plutobook_set_error_message("Invalid image size %.0fx%.0f", canvas_width, canvas_height);
+        return false;
+    }
+
+    size->document_width = document_width;
+    size->document_height = document_height;
+    size->canvas_width = canvas_width;
+    size->canvas_height = canvas_height;
+    return true;
+}
+
+static plutobook_canvas_t* render_document_image(const plutobook_t* book, int64_t width, int64_t height, double scale)
+{
+    image_size_t size;
+    if(!get_document_image_size(book, width, height, scale, &size))
+        return NULL;
+    plutobook_canvas_t* canvas = plutobook_image_canvas_create(size.canvas_width, size.canvas_height, PLUTOBOOK_IMAGE_FORMAT_ARGB32);
+    if(canvas == NULL)
+        return NULL;
+    plutobook_canvas_scale(canvas, size.canvas_width / size.document_width, size.canvas_height / size.document_height);
+    plutobook_render_document(book, canvas);
+    return canvas;
+}
+
+#define PNG_OUTPUT_BUFFER_SIZE 65536
+
+static void store_be32(unsigned char* data, uint32_t value)
+{
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+}
+
+static bool write_png_chunk(plutobook_stream_write_callback_t callback, void* closure, const char* type, const unsigned char* data, size_t length)
+{
+    unsigned char header[8];
+    store_be32(header, length);
+    memcpy(header + 4, type, 4);
+
+    unsigned char trailer[4];
+    uLong crc = crc32(0, (const Bytef*)type, 4);
+    if(length > 0)
+        crc = crc32(crc, data, length);
+    store_be32(trailer, crc);
+    if(callback(closure, (const char*)header, sizeof(header)) != PLUTOBOOK_STREAM_STATUS_SUCCESS)
+        return false;
+    if(length > 0 && callback(closure, (const char*)data, length) != PLUTOBOOK_STREAM_STATUS_SUCCESS)
+        return false;
+    return callback(closure, (const char*)trailer, sizeof(trailer)) == PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+static void convert_png_row(const uint32_t* pixels, int width, png_color_t color, unsigned char* row)
+{
+    if(color == PNG_COLOR_MONO)
+        memset(row, 0, (width + 7) / 8);
+    for(int x = 0; x < width; ++x) {
+        uint32_t pixel = pixels[x];
+        unsigned int a = pixel >> 24;
+        unsigned int r = (pixel >> 16) & 0xFF;
+        unsigned int g = (pixel >> 8) & 0xFF;
+        unsigned int b = pixel & 0xFF;
+        if(color == PNG_COLOR_RGBA) {
+            if(a > 0 && a < 255) {
+                r = (r * 255 + a / 2) / a;
+                g = (g * 255 + a / 2) / a;
+                b = (b * 255 + a / 2) / a;
+            }
+
+            row[x * 4 + 0] = r;
+            row[x * 4 + 1] = g;
+            row[x * 4 + 2] = b;
+            row[x * 4 + 3] = a;
+            continue;
+        }
+
+        r += 255 - a;
+        g += 255 - a;
+        b += 255 - a;
+        if(color == PNG_COLOR_RGB) {
+            row[x * 3 + 0] = r;
+            row[x * 3 + 1] = g;
+            row[x * 3 + 2] = b;
+            continue;
+        }
+
+        unsigned int gray = (r * 77 + g * 150 + b * 29 + 128) >> 8;
+        if(color == PNG_COLOR_GRAY) {
+            row[x] = gray;
+        } else if(gray >= 128) {
+            row[x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
+
+static unsigned char paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if(pa <= pb && pa <= pc)
+        return a;
+    if(pb <= pc)
+        return b;
+    return c;
+}
+
+static void filter_png_row(png_filter_t filter, const unsigned char* row, const unsigned char* prev, size_t length, size_t bpp, unsigned char* out)
+{
+    out[0] = filter;
+    for(size_t i = 0; i < length; ++i) {
+        int left = i >= bpp ? row[i - bpp] : 0;
+        int up = prev[i];
+        int upper_left = i >= bpp ? prev[i - bpp] : 0;
+        switch(filter) {
+        case PNG_FILTER_SUB:
+            out[i + 1] = row[i] - left;
+            break;
+        case PNG_FILTER_UP:
+            out[i + 1] = row[i] - up;
+            break;
+        case PNG_FILTER_AVERAGE:
+            out[i + 1] = row[i] - (left + up) / 2;
+            break;
+        case PNG_FILTER_PAETH:
+            out[i + 1] = row[i] - paeth_predictor(left, up, upper_left);
+            break;
+        default:
+            out[i + 1] = row[i];
+            break;
+        }
+    }
+}
+
+static bool encode_png_canvas(const plutobook_canvas_t* canvas, const png_options_t* options, plutobook_stream_write_callback_t callback, void* closure)
+{
+    int width = plutobook_image_canvas_get_width(canvas);
+    int height = plutobook_image_canvas_get_height(canvas);
+    int stride = plutobook_image_canvas_get_stride(canvas);
+    const unsigned char* data = plutobook_image_canvas_get_data(canvas);
+
+    png_color_t color = options->colorType == PNG_COLOR_DEFAULT ? PNG_COLOR_RGBA : options->colorType;
+    png_filter_t filter = options->filter;
+    if(filter == PNG_FILTER_DEFAULT)
+        filter = color == PNG_COLOR_MONO ? PNG_FILTER_NONE : PNG_FILTER_ADAPTIVE;
+    static const unsigned char color_types[] = {6, 2, 0, 0};
+    static const size_t channels[] = {4, 3, 1, 1};
+    size_t bpp = channels[color];
+    size_t row_length = color == PNG_COLOR_MONO ? (size_t)(width + 7) / 8 : width * bpp;
+
+    unsigned char header[13];
+    store_be32(header, width);
+    store_be32(header + 4, height);
+    header[8] = color == PNG_COLOR_MONO ? 1 : 8;
+    header[9] = color_types[color];
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if(callback(closure, (const char*)signature, sizeof(signature)) != PLUTOBOOK_STREAM_STATUS_SUCCESS
+        || !write_png_chunk(callback, closure, "IHDR", header, sizeof(header))) {
+        plutobook_set_error_message("Unable to write PNG data");
+        return false;
+    }
+
+    unsigned char* rows = calloc(2, row_length);
+    unsigned char* filtered = malloc(5 * (row_length + 1));
+    unsigned char* output = malloc(PNG_OUTPUT_BUFFER_SIZE);
+    if(rows == NULL || filtered == NULL || output == NULL) {
+        free(rows);
+        free(filtered);
+        free(output);
+        errno = ENOMEM;
+        plutobook_set_error_message("%s", strerror(ENOMEM));
+        return false;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int level = options->compressionLevel == -1 ? Z_DEFAULT_COMPRESSION : options->compressionLevel;
+    if(deflateInit2(&stream, level, Z_DEFLATED, 15, 8, filter == PNG_FILTER_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED) != Z_OK) {
+        free(rows);
+        free(filtered);
+        free(output);
+        plutobook_set_error_message("Unable to initialize PNG compression");
+        return false;
+    }
+
+    unsigned char* row = rows;
+    unsigned char* prev = rows + row_length;
+
+    bool success = true;
+    stream.next_out = output;
+    stream.avail_out = PNG_OUTPUT_BUFFER_SIZE;
+    for(int y = 0; y <= height && success; ++y) {
+        int flush = Z_FINISH;
+        if(y < height) {
+            convert_png_row((const uint32_t*)(data + (size_t)y * stride), width, color, row);
+
+            unsigned char* line = filtered;
+            if(filter == PNG_FILTER_ADAPTIVE) {
+                unsigned long best_score = ULONG_MAX;
+                for(int candidate = PNG_FILTER_NONE; candidate <= PNG_FILTER_PAETH; ++candidate) {
+                    unsigned char* out = filtered + candidate * (row_length + 1);
+                    filter_png_row(candidate, row, prev, row_length, bpp, out);
+
+                    unsigned long score = 0;
+                    for(size_t i = 1; i <= row_length; ++i)
+                        score += out[i] < 128 ? out[i] : 256 - out[i];
+                    if(score < best_score) {
+                        best_score = score;
+                        line = out;
+                    }
+                }
+            } else {
+                filter_png_row(filter, row, prev, row_length, bpp, line);
+            }
+
+            stream.next_in = line;
+            stream.avail_in = row_length + 1;
+            flush = Z_NO_FLUSH;
+
+            unsigned char* swap = prev;
+            prev = row;
+            row = swap;
+        }
+
+        int status;
+        do {
+            status = deflate(&stream, flush);
+            if(status == Z_STREAM_ERROR) {
+                plutobook_set_error_message("PNG compression failed");
+                success = false;
+                break;
+            }
+
+            if(stream.avail_out == 0 || (status == Z_STREAM_END && stream.avail_out < PNG_OUTPUT_BUFFER_SIZE)) {
+                if(!write_png_chunk(callback, closure, "IDAT", output, PNG_OUTPUT_BUFFER_SIZE - stream.avail_out)) {
+                    plutobook_set_error_message("Unable to write PNG data");
+                    success = false;
+                    break;
+                }
+
+                stream.next_out = output;
+                stream.avail_out = PNG_OUTPUT_BUFFER_SIZE;
+            }
+        } while(flush == Z_FINISH ? status != Z_STREAM_END : stream.avail_in > 0);
+    }
+
+    deflateEnd(&stream);
+    free(rows);
+    free(filtered);
+    free(output);
+    if(success && !write_png_chunk(callback, closure, "IEND", NULL, 0)) {
+        plutobook_set_error_message("Unable to write PNG data");
+        return false;
+    }
+
+    return success;
+}
+
+#define JPEG_OUTPUT_BUFFER_SIZE 4096
+#define JPEG_MAX_DIMENSION 65535
+
+static const unsigned char jpeg_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const unsigned char jpeg_luma_quant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const unsigned char jpeg_chroma_quant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+static const unsigned char jpeg_luma_dc_bits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const unsigned char jpeg_chroma_dc_bits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const unsigned char jpeg_dc_values[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const unsigned char jpeg_luma_ac_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+static const unsigned char jpeg_luma_ac_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA
+};
+
+static const unsigned char jpeg_chroma_ac_bits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const unsigned char jpeg_chroma_ac_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+    0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+    0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+    0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA
+};
+
+typedef struct {
+    unsigned short codes[256];
+    unsigned char lengths[256];
+} jpeg_huffman_t;
+
+typedef struct {
+    plutobook_stream_write_callback_t callback;
+    void* closure;
+    unsigned char data[JPEG_OUTPUT_BUFFER_SIZE];
+    size_t size;
+    uint32_t bits;
+    int count;
+    bool failed;
+    float cosines[8][8];
+    float luma_divisors[64];
+    float chroma_divisors[64];
+    unsigned char luma_quant[64];
+    unsigned char chroma_quant[64];
+    jpeg_huffman_t luma_dc;
+    jpeg_huffman_t luma_ac;
+    jpeg_huffman_t chroma_dc;
+    jpeg_huffman_t chroma_ac;
+} jpeg_encoder_t;
+
+static void jpeg_build_huffman(const unsigned char bits[16], const unsigned char* values, jpeg_huffman_t* table)
+{
+    unsigned int code = 0;
+    size_t index = 0;
+    for(int length = 1; length <= 16; ++length) {
+        for(int i = 0; i < bits[length - 1]; ++i) {
+            table->codes[values[index]] = code++;
+            table->lengths[values[index]] = length;
+            index++;
+        }
+
+        code <<= 1;
+    }
+}
+
+static void jpeg_build_quant(const unsigned char base[64], int quality, unsigned char table[64], float divisors[64])
+{
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for(int i = 0; i < 64; ++i) {
+        int value = (base[i] * scale + 50) / 100;
+        table[i] = value < 1 ? 1 : value > 255 ? 255 : value;
+        divisors[i] = table[i];
+    }
+}
+
+static void jpeg_flush(jpeg_encoder_t* encoder)
+{
+    if(encoder->size > 0 && !encoder->failed && encoder->callback(encoder->closure, (const char*)encoder->data, encoder->size) != PLUTOBOOK_STREAM_STATUS_SUCCESS)
+        encoder->failed = true;
+    encoder->size = 0;
+}
+
+static void jpeg_write_byte(jpeg_encoder_t* encoder, unsigned char value)
+{
+    encoder->data[encoder->size++] = value;
+    if(encoder->size == JPEG_OUTPUT_BUFFER_SIZE) {
+        jpeg_flush(encoder);
+    }
+}
+
+static void jpeg_write_marker(jpeg_encoder_t* encoder, unsigned char marker, const unsigned char* data, size_t length)
+{
+    jpeg_write_byte(encoder, 0xFF);
+    jpeg_write_byte(encoder, marker);
+    jpeg_write_byte(encoder, (length + 2) >> 8);
+    jpeg_write_byte(encoder, (length + 2) & 0xFF);
+    for(size_t i = 0; i < length; ++i) {
+        jpeg_write_byte(encoder, data[i]);
+    }
+}
+
+static void jpeg_write_huffman_table(jpeg_encoder_t* encoder, unsigned char id, const unsigned char bits[16], const unsigned char* values)
+{
+    unsigned char data[1 + 16 + 162];
+    size_t count = 0;
+    for(int i = 0; i < 16; ++i)
+        count += bits[i];
+    data[0] = id;
+    memcpy(data + 1, bits, 16);
+    memcpy(data + 17, values, count);
+    jpeg_write_marker(encoder, 0xC4, data, 17 + count);
+}
+
+static void jpeg_write_bits(jpeg_encoder_t* encoder, unsigned int value, int length)
+{
+    encoder->bits = (encoder->bits << length) | (value & ((1u << length) - 1));
+    encoder->count += length;
+    while(encoder->count >= 8) {
+        unsigned char byte = encoder->bits >> (encoder->count - 8);
+        jpeg_write_byte(encoder, byte);
+        if(byte == 0xFF)
+            jpeg_write_byte(encoder, 0);
+        encoder->count -= 8;
+    }
+
+    encoder->bits &= (1u << encoder->count) - 1;
+}
+
+static void jpeg_write_coefficient(jpeg_encoder_t* encoder, const jpeg_huffman_t* table, int run, int value)
+{
+    int category = 0;
+    while(abs(value) >> category)
+        category++;
+    int symbol = run << 4 | category;
+    jpeg_write_bits(encoder, table->codes[symbol], table->lengths[symbol]);
+    if(category > 0) {
+        jpeg_write_bits(encoder, value < 0 ? value + (1 << category) - 1 : value, category);
+    }
+}
+
+static void jpeg_encode_block(jpeg_encoder_t* encoder, const float samples[64], const float divisors[64], const jpeg_huffman_t* dc, const jpeg_huffman_t* ac, int* predictor)
+{
+    float rows[64];
+    for(int y = 0; y < 8; ++y) {
+        for(int u = 0; u < 8; ++u) {
+            float sum = 0;
+            for(int x = 0; x < 8; ++x)
+                sum += encoder->cosines[u][x] * samples[y * 8 + x];
+            rows[y * 8 + u] = sum;
+        }
+    }
+
+    int coefficients[64];
+    for(int k = 0; k < 64; ++k) {
+        int index = jpeg_zigzag[k];
+        float sum = 0;
+        for(int y = 0; y < 8; ++y)
+            sum += encoder->cosines[index / 8][y] * rows[y * 8 + index % 8];
+        long value = lroundf(sum / divisors[index]);
+        coefficients[k] = value < -1023 ? -1023 : value > 1023 ? 1023 : value;
+    }
+
+    jpeg_write_coefficient(encoder, dc, 0, coefficients[0] - *predictor);
+    *predictor = coefficients[0];
+
+    int run = 0;
+    for(int k = 1; k < 64; ++k) {
+        if(coefficients[k] == 0) {
+            run++;
+            continue;
+        }
+
+        while(run > 15) {
+            jpeg_write_bits(encoder, ac->codes[0xF0], ac->lengths[0xF0]);
+            run -= 16;
+        }
+
+        jpeg_write_coefficient(encoder, ac, run, coefficients[k]);
+        run = 0;
+    }
+
+    if(run > 0) {
+        jpeg_write_bits(encoder, ac->codes[0x00], ac->lengths[0x00]);
+    }
+}
+
+static bool encode_jpeg_canvas(const plutobook_canvas_t* canvas, int quality, plutobook_stream_write_callback_t callback, void* closure)
+{
+    int width = plutobook_image_canvas_get_width(canvas);
+    int height = plutobook_image_canvas_get_height(canvas);
+    int stride = plutobook_image_canvas_get_stride(canvas);
+    const unsigned char* data = plutobook_image_canvas_get_data(canvas);
+    if(width > JPEG_MAX_DIMENSION || height > JPEG_MAX_DIMENSION) {
+        plutobook_set_error_message("Image is too large for JPEG");
+        return false;
+    }
+
+    jpeg_encoder_t* encoder = malloc(sizeof(jpeg_encoder_t));
+    unsigned char* strip = malloc((size_t)width * 3 * 16);
+    if(encoder == NULL || strip == NULL) {
+        free(encoder);
+        free(strip);
+        errno = ENOMEM;
+        plutobook_set_error_message("%s", strerror(ENOMEM));
+        return false;
+    }
+
+    encoder->callback = callback;
+    encoder->closure = closure;
+    encoder->size = 0;
+    encoder->bits = 0;
+    encoder->count = 0;
+    encoder->failed = false;
+    for(int u = 0; u < 8; ++u) {
+        for(int x = 0; x < 8; ++x) {
+            encoder->cosines[u][x] = (u == 0 ? sqrtf(0.125f) : 0.5f) * cosf((2 * x + 1) * u * 3.14159265f / 16);
+        }
+    }
+
+    jpeg_build_quant(jpeg_luma_quant, quality, encoder->luma_quant, encoder->luma_divisors);
+    jpeg_build_quant(jpeg_chroma_quant, quality, encoder->chroma_quant, encoder->chroma_divisors);
+    jpeg_build_huffman(jpeg_luma_dc_bits, jpeg_dc_values, &encoder->luma_dc);
+    jpeg_build_huffman(jpeg_luma_ac_bits, jpeg_luma_ac_values, &encoder->luma_ac);
+    jpeg_build_huffman(jpeg_chroma_dc_bits, jpeg_dc_values, &encoder->chroma_dc);
+    jpeg_build_huffman(jpeg_chroma_ac_bits, jpeg_chroma_ac_values, &encoder->chroma_ac);
+
+    static const unsigned char jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    jpeg_write_byte(encoder, 0xFF);
+    jpeg_write_byte(encoder, 0xD8);
+    jpeg_write_marker(encoder, 0xE0, jfif, sizeof(jfif));
+
+    unsigned char quant[130];
+    quant[0] = 0;
+    quant[65] = 1;
+    for(int k = 0; k < 64; ++k) {
+        quant[1 + k] = encoder->luma_quant[jpeg_zigzag[k]];
+        quant[66 + k] = encoder->chroma_quant[jpeg_zigzag[k]];
+    }
+
+    jpeg_write_marker(encoder, 0xDB, quant, sizeof(quant));
+
+    const unsigned char frame[15] = {
+        8, height >> 8, height & 0xFF, width >> 8, width & 0xFF, 3,
+        1, 0x22, 0,
+        2, 0x11, 1,
+        3, 0x11, 1
+    };
+
+    jpeg_write_marker(encoder, 0xC0, frame, sizeof(frame));
+    jpeg_write_huffman_table(encoder, 0x00, jpeg_luma_dc_bits, jpeg_dc_values);
+    jpeg_write_huffman_table(encoder, 0x10, jpeg_luma_ac_bits, jpeg_luma_ac_values);
+    jpeg_write_huffman_table(encoder, 0x01, jpeg_chroma_dc_bits, jpeg_dc_values);
+    jpeg_write_huffman_table(encoder, 0x11, jpeg_chroma_ac_bits, jpeg_chroma_ac_values);
+
+    static const unsigned char scan[10] = {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+    jpeg_write_marker(encoder, 0xDA, scan, sizeof(scan));
+
+    int predictors[3] = {0, 0, 0};
+    for(int top = 0; top < height && !encoder->failed; top += 16) {
+        for(int y = 0; y < 16; ++y) {
+            int row = top + y < height ? top + y : height - 1;
+            convert_png_row((const uint32_t*)(data + (size_t)row * stride), width, PNG_COLOR_RGB, strip + (size_t)y * width * 3);
+        }
+
+        for(int left = 0; left < width; left += 16) {
+            float luma[4][64];
+            float blue[64] = {0};
+            float red[64] = {0};
+            for(int y = 0; y < 16; ++y) {
+                for(int x = 0; x < 16; ++x) {
+                    int column = left + x < width ? left + x : width - 1;
+                    const unsigned char* pixel = strip + ((size_t)y * width + column) * 3;
+                    float r = pixel[0];
+                    float g = pixel[1];
+                    float b = pixel[2];
+                    luma[(y / 8) * 2 + x / 8][(y % 8) * 8 + x % 8] = 0.299f * r + 0.587f * g + 0.114f * b - 128;
+                    blue[(y / 2) * 8 + x / 2] += (-0.168736f * r - 0.331264f * g + 0.5f * b) / 4;
+                    red[(y / 2) * 8 + x / 2] += (0.5f * r - 0.418688f * g - 0.081312f * b) / 4;
+                }
+            }
+
+            for(int i = 0; i < 4; ++i)
+                jpeg_encode_block(encoder, luma[i], encoder->luma_divisors, &encoder->luma_dc, &encoder->luma_ac, &predictors[0]);
+            jpeg_encode_block(encoder, blue, encoder->chroma_divisors, &encoder->chroma_dc, &encoder->chroma_ac, &predictors[1]);
+            jpeg_encode_block(encoder, red, encoder->chroma_divisors, &encoder->chroma_dc, &encoder->chroma_ac, &predictors[2]);
+        }
+    }
+
+    if(encoder->count > 0)
+        jpeg_write_bits(encoder, 0x7F, 8 - encoder->count);
+    jpeg_write_byte(encoder, 0xFF);
+    jpeg_write_byte(encoder, 0xD9);
+    jpeg_flush(encoder);
+
+    bool success = !encoder->failed;
+    free(encoder);
+    free(strip);
+    if(!success) {
+        plutobook_set_error_message("Unable to write JPEG data");
+        return false;
+    }
+
+    return true;
+}
+
+static bool get_image_dimensions(const unsigned char* data, size_t length, unsigned int* width, unsigned int* height)
+{
+    static const unsigned char png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if(length >= 24 && memcmp(data, png_signature, 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0) {
+        *width = (unsigned int)data[16] << 24 | data[17] << 16 | data[18] << 8 | data[19];
+        *height = (unsigned int)data[20] << 24 | data[21] << 16 | data[22] << 8 | data[23];
+        return true;
+    }
+
+    if(length < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+    size_t offset = 2;
+    while(offset + 9 <= length) {
+        if(data[offset] != 0xFF)
+            return false;
+        unsigned char marker = data[offset + 1];
+        if(marker == 0xFF) {
+            offset++;
+            continue;
+        }
+
+        size_t segment_length = data[offset + 2] << 8 | data[offset + 3];
+        if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            *height = data[offset + 5] << 8 | data[offset + 6];
+            *width = data[offset + 7] << 8 | data[offset + 8];
+            return true;
+        }
+
+        offset += 2 + segment_length;
+    }
+
+    return false;
+}
+
+#define JPEG_DOWNSAMPLE_QUALITY 85
+
+static plutobook_resource_data_t* create_image_wrapper(const char* data, size_t length, const char* mime_type, unsigned int width, unsigned int height)
+{
+    static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const char suffix[] = "\"/></svg>";
+
+    char prefix[512];
+    int prefix_length = snprintf(prefix, sizeof(prefix),
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"%u\" height=\"%u\" viewBox=\"0 0 %u %u\" preserveAspectRatio=\"none\">"
+        "<image width=\"%u\" height=\"%u\" preserveAspectRatio=\"none\" xlink:href=\"data:%s;base64,", width, height, width, height, width, height, mime_type);
+    size_t wrapper_length = prefix_length + (length + 2) / 3 * 4 + sizeof(suffix) - 1;
+    if(wrapper_length > UINT_MAX)
+        return NULL;
+    char* wrapper = malloc(wrapper_length);
+    if(wrapper == NULL) {
+        return NULL;
+    }
+
+    char* out = wrapper;
+    memcpy(out, prefix, prefix_length);
+    out += prefix_length;
+
+    const unsigned char* in = (const unsigned char*)data;
+    for(size_t i = 0; i < length; i += 3) {
+        uint32_t value = (uint32_t)in[i] << 16;
+        if(i + 1 < length)
+            value |= in[i + 1] << 8;
+        if(i + 2 < length)
+            value |= in[i + 2];
+        *out++ = base64_chars[(value >> 18) & 0x3F];
+        *out++ = base64_chars[(value >> 12) & 0x3F];
+        *out++ = i + 1 < length ? base64_chars[(value >> 6) & 0x3F] : '=';
+        *out++ = i + 2 < length ? base64_chars[value & 0x3F] : '=';
+    }
+
+    memcpy(out, suffix, sizeof(suffix) - 1);
+    plutobook_resource_data_t* resource = plutobook_resource_data_create_without_copy(wrapper, wrapper_length, "image/svg+xml", "utf-8", free, wrapper);
+    if(resource == NULL)
+        free(wrapper);
+    return resource;
+}
+
+static plutobook_resource_data_t* downsample_image_resource(plutobook_resource_data_t* resource, double max_width, double max_height)
+{
+    const unsigned char* content = (const unsigned char*)plutobook_resource_data_get_content(resource);
+    unsigned int content_length = plutobook_resource_data_get_content_length(resource);
+
+    unsigned int width, height;
+    if(!get_image_dimensions(content, content_length, &width, &height) || width == 0 || height == 0)
+        return resource;
+    if(width <= ceil(max_width) && height <= ceil(max_height))
+        return resource;
+    double scale = fmin(max_width / width, max_height / height);
+    int64_t target_width = ceil(width * scale);
+    int64_t target_height = ceil(height * scale);
+
+    plutobook_page_size_t size = PLUTOBOOK_MAKE_PAGE_SIZE(width * PLUTOBOOK_UNITS_PX, height * PLUTOBOOK_UNITS_PX);
+    plutobook_t* book = plutobook_create(size, PLUTOBOOK_MAKE_PAGE_MARGINS(0, 0, 0, 0), PLUTOBOOK_MEDIA_TYPE_SCREEN);
+    if(!plutobook_load_image(book, (const char*)content, content_length, plutobook_resource_data_get_mime_type(resource), "", "", "", "")) {
+        plutobook_destroy(book);
+        return resource;
+    }
+
+    plutobook_canvas_t* canvas = render_document_image(book, target_width, target_height, 1);
+    plutobook_destroy(book);
+    if(canvas == NULL) {
+        return resource;
+    }
+
+    bool jpeg = content[0] == 0xFF && content[1] == 0xD8;
+    memory_stream_t stream;
+    memory_stream_init(&stream);
+    bool encoded;
+    if(jpeg) {
+        encoded = encode_jpeg_canvas(canvas, JPEG_DOWNSAMPLE_QUALITY, stream_write_func, &stream);
+    } else {
+        png_options_t options;
+        png_options_init(&options);
+        encoded = encode_png_canvas(canvas, &options, stream_write_func, &stream);
+    }
+
+    if(encoded && stream.size < content_length) {
+        plutobook_resource_data_t* wrapper = create_image_wrapper(stream.data, stream.size, jpeg ? "image/jpeg" : "image/png", width, height);
+        if(wrapper) {
+            plutobook_resource_data_destroy(resource);
+            resource = wrapper;
+        }
+    }
+
+    plutobook_canvas_destroy(canvas);
+    memory_stream_destroy(&stream);
+    return resource;
+}
+
+typedef struct resource_cache_entry {
+    char* url;
+    char* content;
+    unsigned int content_length;
+    char* mime_type;
+    char* text_encoding;
+    size_t charge;
+    volatile long ref_count;
+    struct resource_cache_entry* next;
+    struct resource_cache_entry* older;
+    struct resource_cache_entry* newer;
+} resource_cache_entry_t;
+
+typedef struct {
+    uv_mutex_t mutex;
+    resource_cache_entry_t** buckets;
+    size_t bucket_count;
+    size_t count;
+    resource_cache_entry_t* newest;
+    resource_cache_entry_t* oldest;
+    size_t capacity;
+    size_t size;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} resource_cache_t;
+
+static resource_cache_t resource_cache;
+static uv_once_t resource_cache_once = UV_ONCE_INIT;
+
+static void resource_cache_init(void)
+{
+    uv_mutex_init(&resource_cache.mutex);
+}
+
+static void resource_cache_entry_release(void* data)
+{
+    resource_cache_entry_t* entry = data;
+    if(atomic_decrement(&entry->ref_count) > 0)
+        return;
+    free(entry->url);
+    free(entry->content);
+    free(entry->mime_type);
+    free(entry->text_encoding);
+    free(entry);
+}
+
+static void resource_cache_remove(resource_cache_entry_t* entry)
+{
+    resource_cache_entry_t** link = &resource_cache.buckets[hash_string(entry->url) & (resource_cache.bucket_count - 1)];
+    while(*link != entry)
+        link = &(*link)->next;
+    *link = entry->next;
+
+    if(entry->older)
+        entry->older->newer = entry->newer;
+    else
+        resource_cache.oldest = entry->newer;
+    if(entry->newer)
+        entry->newer->older = entry->older;
+    else
+        resource_cache.newest = entry->older;
+    resource_cache.size -= entry->charge;
+    resource_cache.count--;
+    resource_cache_entry_release(entry);
+}
+
+static void resource_cache_evict(size_t capacity)
+{
+    while(resource_cache.size > capacity) {
+        resource_cache_remove(resource_cache.oldest);
+        resource_cache.evictions++;
+    }
+}
+
+static bool is_cacheable_url(const char* url)
+{
+    size_t length = strlen(url);
+    return starts_with_ignoring_case(url, length, "http:") || starts_with_ignoring_case(url, length, "https:");
+}
+
+static plutobook_resource_data_t* resource_cache_find(const char* url)
+{
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    if(resource_cache.capacity == 0) {
+        uv_mutex_unlock(&resource_cache.mutex);
+        return NULL;
+    }
+
+    resource_cache_entry_t* entry = NULL;
+    if(resource_cache.bucket_count > 0) {
+        entry = resource_cache.buckets[hash_string(url) & (resource_cache.bucket_count - 1)];
+        while(entry && strcmp(entry->url, url) != 0) {
+            entry = entry->next;
+        }
+    }
+
+    if(entry == NULL) {
+        resource_cache.misses++;
+        uv_mutex_unlock(&resource_cache.mutex);
+        return NULL;
+    }
+
+    if(entry->newer) {
+        entry->newer->older = entry->older;
+        if(entry->older)
+            entry->older->newer = entry->newer;
+        else
+            resource_cache.oldest = entry->newer;
+        entry->older = resource_cache.newest;
+        entry->newer = NULL;
+        resource_cache.newest->newer = entry;
+        resource_cache.newest = entry;
+    }
+
+    resource_cache.hits++;
+    atomic_increment(&entry->ref_count);
+    uv_mutex_unlock(&resource_cache.mutex);
+    return plutobook_resource_data_create_without_copy(entry->content, entry->content_length, entry->mime_type, entry->text_encoding, resource_cache_entry_release, entry);
+}
+
+static void resource_cache_insert(const char* url, const plutobook_resource_data_t* resource)
+{
+    unsigned int content_length = plutobook_resource_data_get_content_length(resource);
+    const char* mime_type = plutobook_resource_data_get_mime_type(resource);
+    const char* text_encoding = plutobook_resource_data_get_text_encoding(resource);
+    if(mime_type == NULL)
+        mime_type = "";
+    if(text_encoding == NULL) {
+        text_encoding = "";
+    }
+
+    size_t charge = sizeof(resource_cache_entry_t) + strlen(url) + strlen(mime_type) + strlen(text_encoding) + 3 + content_length;
+
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    if(resource_cache.capacity == 0 || charge > resource_cache.capacity) {
+        uv_mutex_unlock(&resource_cache.mutex);
+        return;
+    }
+
+    resource_cache_entry_t* entry = calloc(1, sizeof(resource_cache_entry_t));
+    if(entry == NULL) {
+        uv_mutex_unlock(&resource_cache.mutex);
+        return;
+    }
+
+    entry->url = strdup(url);
+    entry->content = malloc(content_length ? content_length : 1);
+    entry->mime_type = strdup(mime_type);
+    entry->text_encoding = strdup(text_encoding);
+    if(entry->url == NULL || entry->content == NULL || entry->mime_type == NULL || entry->text_encoding == NULL) {
+        uv_mutex_unlock(&resource_cache.mutex);
+        entry->ref_count = 1;
+        resource_cache_entry_release(entry);
+        return;
+    }
+
+    memcpy(entry->content, plutobook_resource_data_get_content(resource), content_length);
+    entry->content_length = content_length;
+    entry->charge = charge;
+    entry->ref_count = 1;
+
+    if(resource_cache.bucket_count > 0) {
+        resource_cache_entry_t* existing = resource_cache.buckets[hash_string(url) & (resource_cache.bucket_count - 1)];
+        while(existing && strcmp(existing->url, url) != 0)
+            existing = existing->next;
+        if(existing) {
+            resource_cache_remove(existing);
+        }
+    }
+
+    resource_cache_evict(resource_cache.capacity - charge);
+    if(resource_cache.count >= resource_cache.bucket_count) {
+        size_t bucket_count = resource_cache.bucket_count == 0 ? 64 : resource_cache.bucket_count * 2;
+        resource_cache_entry_t** buckets = calloc(bucket_count, sizeof(resource_cache_entry_t*));
+        if(buckets == NULL) {
+            uv_mutex_unlock(&resource_cache.mutex);
+            resource_cache_entry_release(entry);
+            return;
+        }
+
+        for(resource_cache_entry_t* it = resource_cache.oldest; it; it = it->newer) {
+            size_t index = hash_string(it->url) & (bucket_count - 1);
+            it->next = buckets[index];
+            buckets[index] = it;
+        }
+
+        free(resource_cache.buckets);
+        resource_cache.buckets = buckets;
+        resource_cache.bucket_count = bucket_count;
+    }
+
+    size_t index = hash_string(url) & (resource_cache.bucket_count - 1);
+    entry->next = resource_cache.buckets[index];
+    resource_cache.buckets[index] = entry;
+    entry->older = resource_cache.newest;
+    entry->newer = NULL;
+    if(resource_cache.newest)
+        resource_cache.newest->newer = entry;
+    else
+        resource_cache.oldest = entry;
+    resource_cache.newest = entry;
+    resource_cache.size += charge;
+    resource_cache.count++;
+    uv_mutex_unlock(&resource_cache.mutex);
+}
+
+static napi_value SetResourceCacheSize(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 1, 1)) {
+        return NULL;
+    }
+
+    int64_t capacity;
+    if(!get_integer_argument(env, argv, 0, &capacity)) {
+        return NULL;
+    }
+
+    if(capacity < 0) {
+        napi_throw_range_error(env, NULL, "Resource cache size must not be negative");
+        return NULL;
+    }
+
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    resource_cache.capacity = capacity;
+    resource_cache_evict(resource_cache.capacity);
+    uv_mutex_unlock(&resource_cache.mutex);
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static napi_value GetResourceCacheStats(napi_env env, napi_callback_info info)
+{
+    if(!get_callback_info(env, info, NULL, NULL, NULL, 0, 0)) {
+        return NULL;
+    }
+
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    double stats[] = {
+        resource_cache.capacity,
+        resource_cache.size,
+        resource_cache.count,
+        resource_cache.hits,
+        resource_cache.misses,
+        resource_cache.evictions
+    };
+
+    uv_mutex_unlock(&resource_cache.mutex);
+
+    static const char* names[] = {"capacity", "size", "count", "hits", "misses", "evictions"};
+
+    napi_value result;
+    napi_create_object(env, &result);
+    for(size_t i = 0; i < sizeof(stats) / sizeof(stats[0]); ++i) {
+        napi_value value;
+        napi_create_double(env, stats[i], &value);
+        napi_set_named_property(env, result, names[i], value);
+    }
+
+    return result;
+}
+
+static napi_value ClearResourceCache(napi_env env, napi_callback_info info)
+{
+    if(!get_callback_info(env, info, NULL, NULL, NULL, 0, 0)) {
+        return NULL;
+    }
+
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    resource_cache_evict(0);
+    resource_cache.hits = 0;
+    resource_cache.misses = 0;
+    resource_cache.evictions = 0;
+    uv_mutex_unlock(&resource_cache.mutex);
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static double metric_value(volatile int64_t* value)
+{
+    return (double)atomic_add(value, 0);
+}
+
+static void set_metric_property(napi_env env, napi_value object, const char* name, double value)
+{
+    napi_value property;
+    napi_create_double(env, value, &property);
+    napi_set_named_property(env, object, name, property);
+}
+
+static napi_value create_histogram_object(napi_env env, metric_histogram_t* histogram)
+{
+    napi_value result, buckets;
+    napi_create_object(env, &result);
+    napi_create_array_with_length(env, METRIC_LATENCY_BUCKET_COUNT + 1, &buckets);
+
+    double count = 0;
+    for(size_t i = 0; i <= METRIC_LATENCY_BUCKET_COUNT; ++i) {
+        count += metric_value(&histogram->counts[i]);
+
+        napi_value bucket;
+        napi_create_object(env, &bucket);
+        set_metric_property(env, bucket, "le", i < METRIC_LATENCY_BUCKET_COUNT ? metric_latency_buckets[i] : INFINITY);
+        set_metric_property(env, bucket, "count", count);
+        napi_set_element(env, buckets, i, bucket);
+    }
+
+    napi_set_named_property(env, result, "buckets", buckets);
+    set_metric_property(env, result, "count", count);
+    set_metric_property(env, result, "sum", metric_value(&histogram->sum_us) / 1000);
+    return result;
+}
+
+static napi_value Metrics(napi_env env, napi_callback_info info)
+{
+    if(!get_callback_info(env, info, NULL, NULL, NULL, 0, 0)) {
+        return NULL;
+    }
+
+    uv_once(&resource_cache_once, resource_cache_init);
+    uv_mutex_lock(&resource_cache.mutex);
+    double cache_size = resource_cache.size;
+    uv_mutex_unlock(&resource_cache.mutex);
+
+    napi_value result;
+    napi_create_object(env, &result);
+    set_metric_property(env, result, "booksCreated", metric_value(&metrics.books_created));
+    set_metric_property(env, result, "booksLive", metric_value(&metrics.books_live));
+    set_metric_property(env, result, "nativeBytes", metric_value(&metrics.resource_store_bytes) + cache_size);
+    set_metric_property(env, result, "loads", metric_value(&metrics.loads));
+    set_metric_property(env, result, "loadFailures", metric_value(&metrics.load_failures));
+    set_metric_property(env, result, "fetches", metric_value(&metrics.fetches));
+    set_metric_property(env, result, "fetchFailures", metric_value(&metrics.fetch_failures));
+
+    napi_value renders;
+    napi_create_object(env, &renders);
+    for(int i = 0; i < METRIC_OUTPUT_COUNT; ++i) {
+        napi_value output;
+        napi_create_object(env, &output);
+        set_metric_property(env, output, "count", metric_value(&metrics.renders[i]));
+        set_metric_property(env, output, "failures", metric_value(&metrics.render_failures[i]));
+        set_metric_property(env, output, "bytes", metric_value(&metrics.bytes_produced[i]));
+        napi_set_named_property(env, renders, metric_output_names[i], output);
+    }
+
+    napi_set_named_property(env, result, "renders", renders);
+    napi_set_named_property(env, result, "loadLatency", create_histogram_object(env, &metrics.load_latency));
+    napi_set_named_property(env, result, "writeLatency", create_histogram_object(env, &metrics.write_latency));
+    return result;
+}
+
+typedef enum {
+    BOOK_SOURCE_NONE,
+    BOOK_SOURCE_URL,
+    BOOK_SOURCE_HTML,
+    BOOK_SOURCE_XML,
+    BOOK_SOURCE_DATA,
+    BOOK_SOURCE_IMAGE
+} book_source_kind_t;
+
+typedef struct {
+    book_source_kind_t kind;
+    char* content;
+    size_t length;
+    char* mime_type;
+    char* text_encoding;
+    char* user_style;
+    char* user_script;
+    char* base_url;
+} book_source_t;
+
+static void book_source_clear(book_source_t* source)
+{
+    free(source->content);
+    free(source->mime_type);
+    free(source->text_encoding);
+    free(source->user_style);
+    free(source->user_script);
+    free(source->base_url);
+    memset(source, 0, sizeof(book_source_t));
+}
+
+typedef struct {
+    plutobook_t* book;
+    resource_table_t* prefetched;
+    resource_store_t* resources;
+    bool offline;
+    bool busy;
+    int64_t limits[BOOK_LIMIT_COUNT];
+    volatile int64_t resource_bytes;
+    volatile long resource_count;
+    uint64_t load_start_time;
+    volatile int exceeded_limit;
+    double max_image_dpi;
+    double max_image_width;
+    double max_image_height;
+    bool record;
+    uv_mutex_t record_mutex;
+    resource_table_t recorded;
+    book_source_t source;
+} book_t;
+
+static bool book_limit_exceeded(book_t* self, book_limit_t limit, int64_t value)
+{
+    if(self->limits[limit] == 0 || value <= self->limits[limit])
+        return false;
+    self->exceeded_limit = limit;
+    plutobook_set_error_message("Limit `%s` of %lld exceeded", book_limit_names[limit], (long long)self->limits[limit]);
+    return true;
+}
+
+static plutobook_resource_data_t* book_account_resource(book_t* self, const char* url, plutobook_resource_data_t* resource)
+{
+    if(resource == NULL)
+        return NULL;
+    if(!starts_with_ignoring_case(url, strlen(url), "data:")) {
+        int64_t count = atomic_increment(&self->resource_count);
+        int64_t bytes = atomic_add(&self->resource_bytes, plutobook_resource_data_get_content_length(resource));
+        if(book_limit_exceeded(self, BOOK_LIMIT_MAX_RESOURCE_COUNT, count)
+            || book_limit_exceeded(self, BOOK_LIMIT_MAX_RESOURCE_BYTES, bytes)) {
+            plutobook_resource_data_destroy(resource);
+            return NULL;
+        }
+    }
+
+    if(self->max_image_width > 0)
+        resource = downsample_image_resource(resource, self->max_image_width, self->max_image_height);
+    if(self->record && resource) {
+        uv_mutex_lock(&self->record_mutex);
+        resource_table_insert(&self->recorded, url, plutobook_resource_data_reference(resource));
+        uv_mutex_unlock(&self->record_mutex);
+    }
+
+    return resource;
+}
+
+static plutobook_resource_data_t* book_load_resource(book_t* self, const char* url)
+{
+    int64_t elapsed = (uv_hrtime() - self->load_start_time) / 1000000;
+    if(book_limit_exceeded(self, BOOK_LIMIT_MAX_LAYOUT_MS, elapsed))
+        return NULL;
+    if(self->resources) {
+        plutobook_resource_data_t* resource = resource_store_find(self->resources, url);
+        if(resource) {
+            return resource;
+        }
+    }
+
+    size_t url_length = strlen(url);
+    if(self->offline && !starts_with_ignoring_case(url, url_length, "file:") && !starts_with_ignoring_case(url, url_length, "data:")) {
+        plutobook_set_error_message("Resource \"%s\" is not available offline", url);
+        return NULL;
+    }
+
+    bool cacheable = is_cacheable_url(url);
+    if(cacheable) {
+        plutobook_resource_data_t* resource = resource_cache_find(url);
+        if(resource) {
+            return resource;
+        }
+    }
+
+    plutobook_resource_data_t* resource = plutobook_fetch_url(url);
+    if(resource && cacheable)
+        resource_cache_insert(url, resource);
+    return resource;
+}
+
+static plutobook_resource_data_t* book_fetch_resource(book_t* self, const char* url)
+{
+    if(self->prefetched) {
+        plutobook_resource_data_t* resource = resource_table_find(self->prefetched, url);
+        if(resource) {
+            return book_account_resource(self, url, plutobook_resource_data_reference(resource));
+        }
+    }
+
+    return book_account_resource(self, url, book_load_resource(self, url));
+}
+
+static plutobook_resource_data_t* book_fetch_func(void* closure, const char* url)
+{
+    plutobook_resource_data_t* resource = book_fetch_resource(closure, url);
+    atomic_add(&metrics.fetches, 1);
+    if(resource == NULL)
+        atomic_add(&metrics.fetch_failures, 1);
+    return resource;
+}
+
+static napi_value CreateBook(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 0, 1)) {
+        return NULL;
+    }
+
+    napi_value BookClass;
+    napi_get_reference_value(env, get_instance_data(env)->BookClass_Ref, &BookClass);
+
+    napi_value instance;
+    napi_new_instance(env, BookClass, argc, argv, &instance);
+    return instance;
+}
+
+static void BookClass_Finalize(napi_env env, void* data, void* hint)
+{
+    book_t* self = data;
+    atomic_add(&metrics.books_live, -1);
+    plutobook_destroy(self->book);
+    resource_store_release(self->resources);
+    if(self->record) {
+        resource_table_destroy(&self->recorded);
+        book_source_clear(&self->source);
+        uv_mutex_destroy(&self->record_mutex);
+    }
+
+    free(self);
+}
+
+static void set_date_metadata(plutobook_t* book, plutobook_pdf_metadata_t metadata, double date)
+{
+    char value[sizeof("2025-12-11T05:36:01Z")];
+    time_t time = (time_t)(date / 1000);
+    strftime(value, sizeof(value), "%FT%TZ", gmtime(&time));
+    plutobook_set_metadata(book, metadata, value);
+}
+
+// Passed as an external to the Book constructor by loadSnapshot, which
+// builds the plutobook itself. The constructor takes ownership of `book`
+// and clears it.
+typedef struct {
+    plutobook_t* book;
+    const book_options_t* options;
+} book_restore_t;
+
+static bool book_wrap(napi_env env, napi_value thisArg, plutobook_t* book, const book_options_t* options)
+{
+    book_t* self = malloc(sizeof(book_t));
+    if(self == NULL) {
+        plutobook_destroy(book);
+        napi_throw_error(env, NULL, strerror(ENOMEM));
+        return false;
+    }
+
+    self->book = book;
+    self->prefetched = NULL;
+    self->resources = resource_store_reference(options->resources);
+    self->offline = options->offline;
+    self->busy = false;
+    memcpy(self->limits, options->limits, sizeof(self->limits));
+    self->resource_bytes = 0;
+    self->resource_count = 0;
+    self->load_start_time = uv_hrtime();
+    self->exceeded_limit = -1;
+    self->max_image_dpi = options->maxImageDpi;
+    self->max_image_width = options->size.width / PLUTOBOOK_UNITS_IN * options->maxImageDpi;
+    self->max_image_height = options->size.height / PLUTOBOOK_UNITS_IN * options->maxImageDpi;
+    self->record = options->recordSnapshot;
+    if(self->record) {
+        uv_mutex_init(&self->record_mutex);
+        resource_table_init(&self->recorded);
+        memset(&self->source, 0, sizeof(book_source_t));
+    }
+
+    plutobook_set_custom_resource_fetcher(book, book_fetch_func, self);
+    napi_wrap(env, thisArg, self, BookClass_Finalize, NULL, NULL);
+    atomic_add(&metrics.books_created, 1);
+    atomic_add(&metrics.books_live, 1);
+    return true;
+}
+
+static napi_value BookClass_Constructor(napi_env env, napi_callback_info info)
+{
+    napi_value new_target;
+    napi_get_new_target(env, info, &new_target);
+    if(new_target == NULL) {
+        return CreateBook(env, info);
+    }
+
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+        return NULL;
+    }
+
+    if(argc == 1) {
+        napi_valuetype type;
+        napi_typeof(env, argv[0], &type);
+        if(type == napi_external) {
+            book_restore_t* restore;
+            napi_get_value_external(env, argv[0], (void**)&restore);
+            plutobook_t* book = restore->book;
+            restore->book = NULL;
+            if(!book_wrap(env, thisArg, book, restore->options))
+                return NULL;
+            return thisArg;
+        }
+    }
+
+    book_options_t local_options;
+    book_options_init(&local_options);
+
+    const book_options_t* options = &local_options;
+    if(argc == 1) {
+        options = get_book_options(env, argv, argc, 0, &local_options);
+        if(options == NULL) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    plutobook_t* book = plutobook_create(options->size, options->margins, options->media);
+    if(options->title)
+        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_TITLE, options->title);
+    if(options->subject)
+        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_SUBJECT, options->subject);
+    if(options->author)
+        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_AUTHOR, options->author);
+    if(options->keywords)
+        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_KEYWORDS, options->keywords);
+    if(options->creator) {
+        plutobook_set_metadata(book, PLUTOBOOK_PDF_METADATA_CREATOR, options->creator);
+    }
+
+    if(options->creationDate != -1)
+        set_date_metadata(book, PLUTOBOOK_PDF_METADATA_CREATION_DATE, options->creationDate);
+    if(options->modificationDate != -1) {
+        set_date_metadata(book, PLUTOBOOK_PDF_METADATA_MODIFICATION_DATE, options->modificationDate);
+    }
+
+    if(!book_wrap(env, thisArg, book, options)) {
+        thisArg = NULL;
+    }
+
+cleanup:
+    book_options_destroy(&local_options);
+    return thisArg;
+}
+
+static book_t* get_book(napi_env env, napi_value thisArg)
+{
+    book_t* self;
+    napi_unwrap(env, thisArg, (void**)&self);
+    if(self->busy) {
+        napi_throw_error(env, "ERR_PLUTOPRINT_BUSY", "Book is busy with an asynchronous export");
+        return NULL;
+    }
+
+    return self;
+}
+
+static void throw_limit_error(napi_env env, book_limit_t limit, int64_t value)
+{
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Limit `%s` of %lld exceeded", book_limit_names[limit], (long long)value);
+
+    napi_value code, message, error, property;
+    napi_create_string_utf8(env, "ERR_PLUTOPRINT_LIMIT", NAPI_AUTO_LENGTH, &code);
+    napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &message);
+    napi_create_error(env, code, message, &error);
+    napi_create_string_utf8(env, book_limit_names[limit], NAPI_AUTO_LENGTH, &property);
+    napi_set_named_property(env, error, "limit", property);
+    napi_create_int64(env, value, &property);
+    napi_set_named_property(env, error, "max", property);
+    napi_throw(env, error);
+}
+
+static bool check_book_limit(napi_env env, book_t* self, book_limit_t limit, double value)
+{
+    if(self->limits[limit] == 0 || value <= self->limits[limit])
+        return true;
+    throw_limit_error(env, limit, self->limits[limit]);
+    return false;
+}
+
+static void book_begin_load(book_t* self)
+{
+    self->resource_bytes = 0;
+    self->resource_count = 0;
+    self->load_start_time = uv_hrtime();
+    self->exceeded_limit = -1;
+    if(self->record) {
+        resource_table_destroy(&self->recorded);
+        book_source_clear(&self->source);
+    }
+}
+
+static char* copy_source_string(const char* value)
+{
+    return strdup(value ? value : "");
+}
+
+static void book_record_source(book_t* self, book_source_kind_t kind, const char* content, size_t length,
+    const char* mime_type, const char* text_encoding, const char* user_style, const char* user_script, const char* base_url)
+{
+    if(!self->record)
+        return;
+    book_source_t* source = &self->source;
+    source->kind = kind;
+    source->content = malloc(length + 1);
+    memcpy(source->content, content, length);
+    source->content[length] = '\0';
+    source->length = length;
+    source->mime_type = copy_source_string(mime_type);
+    source->text_encoding = copy_source_string(text_encoding);
+    source->user_style = copy_source_string(user_style);
+    source->user_script = copy_source_string(user_script);
+    source->base_url = copy_source_string(base_url);
+}
+
+static bool book_end_load(napi_env env, book_t* self, bool success)
+{
+    atomic_add(&metrics.loads, 1);
+    metric_histogram_observe(&metrics.load_latency, self->load_start_time);
+    if(self->exceeded_limit == -1) {
+        int64_t elapsed = (uv_hrtime() - self->load_start_time) / 1000000;
+        if(book_limit_exceeded(self, BOOK_LIMIT_MAX_LAYOUT_MS, elapsed)) {
+            success = false;
+        } else if(success && book_limit_exceeded(self, BOOK_LIMIT_MAX_PAGES, plutobook_get_page_count(self->book))) {
+            success = false;
+        }
+    }
+
+    if(self->record && (!success || self->exceeded_limit != -1))
+        book_source_clear(&self->source);
+    if(self->exceeded_limit != -1) {
+        plutobook_clear_content(self->book);
+        throw_limit_error(env, self->exceeded_limit, self->limits[self->exceeded_limit]);
+        atomic_add(&metrics.load_failures, 1);
+        return false;
+    }
+
+    if(!success) {
+        napi_throw_error(env, NULL, plutobook_get_error_message());
+        atomic_add(&metrics.load_failures, 1);
+        return false;
+    }
+
+    return true;
+}
+
+static napi_value Book_PageCount(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    napi_value result;
+    napi_create_uint32(env, plutobook_get_page_count(book), &result);
+    return result;
+}
+
+static napi_value Book_DocumentWidth(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    napi_value result;
+    napi_create_double(env, plutobook_get_document_width(book), &result);
+    return result;
+}
+
+static napi_value Book_DocumentHeight(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    napi_value result;
+    napi_create_double(env, plutobook_get_document_height(book), &result);
+    return result;
+}
+
+static napi_value Book_ViewportWidth(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    napi_value result;
+    napi_create_double(env, plutobook_get_viewport_width(book), &result);
+    return result;
+}
+
+static napi_value Book_ViewportHeight(napi_env env, napi_callback_info info)
+{
+    napi_value thisArg;
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    napi_value result;
+    napi_create_double(env, plutobook_get_viewport_height(book), &result);
+    return result;
+}
+
+#define PREFETCH_DEFAULT_CONCURRENCY 8
+#define PREFETCH_MAX_CONCURRENCY 64
+#define PREFETCH_MAX_RESOURCES 512
+#define PREFETCH_MAX_DEPTH 4
+
+typedef struct {
+    char** items;
+    size_t size;
+    size_t capacity;
+} url_list_t;
+
+static void url_list_init(url_list_t* list)
+{
+    list->items = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+static void url_list_clear(url_list_t* list)
+{
+    for(size_t i = 0; i < list->size; ++i)
+        free(list->items[i]);
+    list->size = 0;
+}
+
+static void url_list_destroy(url_list_t* list)
+{
+    url_list_clear(list);
+    free(list->items);
+}
+
+static bool has_url_scheme(const char* url, size_t length)
+{
+    if(length == 0 || !isalpha((unsigned char)url[0]))
+        return false;
+    for(size_t i = 1; i < length; ++i) {
+        if(url[i] == ':')
+            return true;
+        if(!isalnum((unsigned char)url[i]) && url[i] != '+' && url[i] != '-' && url[i] != '.') {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static void remove_dot_segments(char* path)
+{
+    char* output = path;
+    const char* input = path;
+    while(*input) {
+        if(input[0] == '/' && input[1] == '.' && (input[2] == '/' || input[2] == '\0')) {
+            input += input[2] == '/' ? 2 : 1;
+            if(*input == '\0')
+                *output++ = '/';
+            continue;
+        }
+
+        if(input[0] == '/' && input[1] == '.' && input[2] == '.' && (input[3] == '/' || input[3] == '\0')) {
+            input += input[3] == '/' ? 3 : 2;
+            while(output > path && *--output != '/');
+            if(*input == '\0')
+                *output++ = '/';
+            continue;
+        }
+
+        do {
+            *output++ = *input++;
+        } while(*input && *input != '/');
+    }
+
+    *output = '\0';
+}
+
+static char* resolve_url(const char* base_url, const char* value, size_t length)
+{
+    while(length > 0 && isspace((unsigned char)value[0])) {
+        ++value;
+        --length;
+    }
+
+    while(length > 0 && isspace((unsigned char)value[length - 1]))
+        --length;
+    const char* fragment = memchr(value, '#', length);
+    if(fragment)
+        length = fragment - value;
+    if(length == 0) {
+        return NULL;
+    }
+
+    char* reference = malloc(length + 1);
+    size_t reference_length = 0;
+    for(size_t i = 0; i < length; ++i) {
+        reference[reference_length++] = value[i];
+        if(value[i] == '&' && i + 4 < length && memcmp(value + i + 1, "amp;", 4) == 0) {
+            i += 4;
+        }
+    }
+
+    reference[reference_length] = '\0';
+    if(has_url_scheme(reference, reference_length)) {
+        if(starts_with_ignoring_case(reference, reference_length, "http:")
+            || starts_with_ignoring_case(reference, reference_length, "https:")
+            || starts_with_ignoring_case(reference, reference_length, "file:")) {
+            return reference;
+        }
+
+        free(reference);
+        return NULL;
+    }
+
+    const char* scheme_end = strchr(base_url, ':');
+    if(scheme_end == NULL || !has_url_scheme(base_url, scheme_end - base_url + 1)) {
+        free(reference);
+        return NULL;
+    }
+
+    const char* authority_end = scheme_end + 1;
+    if(authority_end[0] == '/' && authority_end[1] == '/') {
+        authority_end += 2;
+        while(*authority_end && *authority_end != '/' && *authority_end != '?') {
+            ++authority_end;
+        }
+    }
+
+    const char* path_end = authority_end + strcspn(authority_end, "?");
+
+    size_t prefix_length;
+    const char* separator = "";
+    if(reference[0] == '/' && reference[1] == '/') {
+        prefix_length = scheme_end - base_url + 1;
+    } else if(reference[0] == '/') {
+        prefix_length = authority_end - base_url;
+    } else if(reference[0] == '?') {
+        prefix_length = path_end - base_url;
+    } else {
+        const char* slash = path_end;
+        while(slash > authority_end && slash[-1] != '/')
+            --slash;
+        if(slash == authority_end)
+            separator = "/";
+        prefix_length = slash - base_url;
+    }
+
+    size_t separator_length = strlen(separator);
+    char* result = malloc(prefix_length + separator_length + reference_length + 1);
+    memcpy(result, base_url, prefix_length);
+    memcpy(result + prefix_length, separator, separator_length);
+    memcpy(result + prefix_length + separator_length, reference, reference_length + 1);
+    free(reference);
+
+    char* path = strchr(result, ':') + 1;
+    if(path[0] == '/' && path[1] == '/') {
+        path += 2;
+        while(*path && *path != '/' && *path != '?') {
+            ++path;
+        }
+    }
+
+    char* query = strchr(path, '?');
+    char* suffix = query ? strdup(query) : NULL;
+    if(query)
+        *query = '\0';
+    remove_dot_segments(path);
+    if(suffix) {
+        strcat(path, suffix);
+        free(suffix);
+    }
+
+    return result;
+}
+
+static void add_prefetch_url(const char* base_url, const char* value, size_t length, resource_table_t* seen, url_list_t* urls)
+{
+    char* url = resolve_url(base_url, value, length);
+    if(url == NULL)
+        return;
+    if(seen->count >= PREFETCH_MAX_RESOURCES || resource_table_contains(seen, url)) {
+        free(url);
+        return;
+    }
+
+    resource_table_insert(seen, url, NULL);
+    if(urls->size == urls->capacity) {
+        urls->capacity = urls->capacity == 0 ? 16 : urls->capacity * 2;
+        urls->items = realloc(urls->items, urls->capacity * sizeof(char*));
+    }
+
+    urls->items[urls->size++] = url;
+}
+
+static void scan_css_urls(const char* data, size_t length, const char* base_url, resource_table_t* seen, url_list_t* urls)
+{
+    const char* end = data + length;
+    for(const char* it = data; it < end; ++it) {
+        bool is_import = false;
+        if(end - it > 4 && starts_with_ignoring_case(it, end - it, "url(")) {
+            it += 4;
+        } else if(end - it > 7 && starts_with_ignoring_case(it, end - it, "@import")) {
+            it += 7;
+            is_import = true;
+            while(it < end && isspace((unsigned char)*it))
+                ++it;
+            if(end - it > 4 && starts_with_ignoring_case(it, end - it, "url(")) {
+                it += 4;
+                is_import = false;
+            }
+        } else {
+            continue;
+        }
+
+        while(it < end && isspace((unsigned char)*it))
+            ++it;
+        if(it == end)
+            break;
+        const char* value = it;
+        if(*it == '"' || *it == '\'') {
+            char quote = *it++;
+            value = it;
+            while(it < end && *it != quote)
+                ++it;
+        } else if(!is_import) {
+            while(it < end && *it != ')')
+                ++it;
+        } else {
+            continue;
+        }
+
+        add_prefetch_url(base_url, value, it - value, seen, urls);
+        if(it == end) {
+            break;
+        }
+    }
+}
+
+static void scan_markup_urls(const char* data, size_t length, const char* base_url, resource_table_t* seen, url_list_t* urls)
+{
+    const char* end = data + length;
+    const char* it = data;
+    while(it < end) {
+        it = memchr(it, '<', end - it);
+        if(it == NULL)
+            break;
+        ++it;
+        if(end - it >= 3 && memcmp(it, "!--", 3) == 0) {
+            const char* close = it + 3;
+            while(close + 3 <= end && memcmp(close, "-->", 3) != 0)
+                ++close;
+            it = close;
+            continue;
+        }
+
+        const char* tag = it;
+        while(it < end && (isalnum((unsigned char)*it) || *it == ':' || *it == '-'))
+            ++it;
+        size_t tag_length = it - tag;
+        if(tag_length == 0) {
+            continue;
+        }
+
+        bool is_link = tag_length == 4 && starts_with_ignoring_case(tag, tag_length, "link");
+        bool is_image = tag_length == 5 && starts_with_ignoring_case(tag, tag_length, "image");
+        bool is_input = tag_length == 5 && starts_with_ignoring_case(tag, tag_length, "input");
+        bool has_src = is_image || is_input
+            || (tag_length == 3 && starts_with_ignoring_case(tag, tag_length, "img"))
+            || (tag_length == 6 && starts_with_ignoring_case(tag, tag_length, "source"));
+        bool is_stylesheet = false;
+        bool is_image_input = false;
+
+        const char* src = NULL;
+        size_t src_length = 0;
+        const char* href = NULL;
+        size_t href_length = 0;
+        while(it < end && *it != '>') {
+            while(it < end && (isspace((unsigned char)*it) || *it == '/'))
+                ++it;
+            const char* name = it;
+            while(it < end && !isspace((unsigned char)*it) && *it != '=' && *it != '>' && *it != '/')
+                ++it;
+            size_t name_length = it - name;
+            while(it < end && isspace((unsigned char)*it))
+                ++it;
+            if(name_length == 0 || it == end || *it != '=') {
+                if(name_length == 0 && it < end && *it != '>')
+                    ++it;
+                continue;
+            }
+
+            ++it;
+            while(it < end && isspace((unsigned char)*it))
+                ++it;
+            const char* value = it;
+            if(it < end && (*it == '"' || *it == '\'')) {
+                char quote = *it++;
+                value = it;
+                while(it < end && *it != quote)
+                    ++it;
+            } else {
+                while(it < end && !isspace((unsigned char)*it) && *it != '>') {
+                    ++it;
+                }
+            }
+
+            size_t value_length = it - value;
+            if(it < end && (*it == '"' || *it == '\''))
+                ++it;
+            if(name_length == 3 && starts_with_ignoring_case(name, name_length, "src")) {
+                src = value;
+                src_length = value_length;
+            } else if(is_input && name_length == 4 && starts_with_ignoring_case(name, name_length, "type")) {
+                is_image_input = value_length == 5 && starts_with_ignoring_case(value, value_length, "image");
+            } else if((name_length == 4 && starts_with_ignoring_case(name, name_length, "href"))
+                || (name_length == 10 && starts_with_ignoring_case(name, name_length, "xlink:href"))) {
+                href = value;
+                href_length = value_length;
+            } else if(is_link && name_length == 3 && starts_with_ignoring_case(name, name_length, "rel")) {
+                for(size_t i = 0; i + 10 <= value_length; ++i) {
+                    if(starts_with_ignoring_case(value + i, value_length - i, "stylesheet")) {
+                        is_stylesheet = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if(src && has_src && (!is_input || is_image_input))
+            add_prefetch_url(base_url, src, src_length, seen, urls);
+        if(href && ((is_link && is_stylesheet) || is_image)) {
+            add_prefetch_url(base_url, href, href_length, seen, urls);
+        }
+    }
+
+    scan_css_urls(data, length, base_url, seen, urls);
+}
+
+static bool is_css_resource(const char* url, plutobook_resource_data_t* resource)
+{
+    const char* mime_type = plutobook_resource_data_get_mime_type(resource);
+    if(mime_type && strstr(mime_type, "css"))
+        return true;
+    size_t length = strcspn(url, "?");
+    return length > 4 && starts_with_ignoring_case(url + length - 4, 4, ".css");
+}
+
+static void scan_resource_urls(const char* url, plutobook_resource_data_t* resource, resource_table_t* seen, url_list_t* urls)
+{
+    const char* content = plutobook_resource_data_get_content(resource);
+    size_t content_length = plutobook_resource_data_get_content_length(resource);
+    if(is_css_resource(url, resource)) {
+        scan_css_urls(content, content_length, url, seen, urls);
+        return;
+    }
+
+    const char* mime_type = plutobook_resource_data_get_mime_type(resource);
+    if(mime_type == NULL || *mime_type == '\0' || strstr(mime_type, "html") || strstr(mime_type, "xml")) {
+        scan_markup_urls(content, content_length, url, seen, urls);
+    }
+}
+
+typedef struct {
+    book_t* book;
+    char** urls;
+    plutobook_resource_data_t** results;
+    size_t count;
+    size_t next;
+    size_t pending;
+    bool stopped;
+    uv_mutex_t mutex;
+    uv_cond_t work_cond;
+    uv_cond_t done_cond;
+    uv_thread_t threads[PREFETCH_MAX_CONCURRENCY];
+    size_t thread_count;
+    size_t concurrency;
+} prefetch_pool_t;
+
+static void prefetch_pool_drain(prefetch_pool_t* pool)
+{
+    while(pool->next < pool->count) {
+        size_t index = pool->next++;
+        uv_mutex_unlock(&pool->mutex);
+        plutobook_resource_data_t* resource = book_load_resource(pool->book, pool->urls[index]);
+        uv_mutex_lock(&pool->mutex);
+        pool->results[index] = resource;
+        if(--pool->pending == 0) {
+            uv_cond_signal(&pool->done_cond);
+        }
+    }
+}
+
+static void prefetch_worker(void* arg)
+{
+    prefetch_pool_t* pool = arg;
+    uv_mutex_lock(&pool->mutex);
+    while(true) {
+        while(!pool->stopped && pool->next >= pool->count)
+            uv_cond_wait(&pool->work_cond, &pool->mutex);
+        if(pool->stopped)
+            break;
+        prefetch_pool_drain(pool);
+    }
+
+    uv_mutex_unlock(&pool->mutex);
+}
+
+static void prefetch_pool_init(prefetch_pool_t* pool, book_t* book, size_t concurrency)
+{
+    pool->book = book;
+    pool->urls = NULL;
+    pool->results = NULL;
+    pool->count = 0;
+    pool->next = 0;
+    pool->pending = 0;
+    pool->stopped = false;
+    pool->thread_count = 0;
+    pool->concurrency = concurrency;
+    uv_mutex_init(&pool->mutex);
+    uv_cond_init(&pool->work_cond);
+    uv_cond_init(&pool->done_cond);
+}
+
+static void prefetch_pool_destroy(prefetch_pool_t* pool)
+{
+    uv_mutex_lock(&pool->mutex);
+    pool->stopped = true;
+    uv_cond_broadcast(&pool->work_cond);
+    uv_mutex_unlock(&pool->mutex);
+    for(size_t i = 0; i < pool->thread_count; ++i)
+        uv_thread_join(&pool->threads[i]);
+    uv_cond_destroy(&pool->done_cond);
+    uv_cond_destroy(&pool->work_cond);
+    uv_mutex_destroy(&pool->mutex);
+}
+
+static void prefetch_pool_run(prefetch_pool_t* pool, const url_list_t* urls, plutobook_resource_data_t** results)
+{
+    size_t thread_count = pool->concurrency < urls->size ? pool->concurrency : urls->size;
+    while(pool->thread_count + 1 < thread_count) {
+        if(uv_thread_create(&pool->threads[pool->thread_count], prefetch_worker, pool) != 0)
+            break;
+        pool->thread_count++;
+    }
+
+    uv_mutex_lock(&pool->mutex);
+    pool->urls = urls->items;
+    pool->results = results;
+    pool->count = urls->size;
+    pool->next = 0;
+    pool->pending = urls->size;
+    uv_cond_broadcast(&pool->work_cond);
+    prefetch_pool_drain(pool);
+    while(pool->pending > 0)
+        uv_cond_wait(&pool->done_cond, &pool->mutex);
+    pool->count = 0;
+    pool->next = 0;
+    uv_mutex_unlock(&pool->mutex);
+}
+
+static void prefetch_resources(book_t* book, const char* url, plutobook_resource_data_t* document, size_t concurrency, resource_table_t* prefetched)
+{
+    resource_table_t seen;
+    resource_table_init(&seen);
+    resource_table_insert(&seen, url, NULL);
+
+    url_list_t urls;
+    url_list_init(&urls);
+    scan_resource_urls(url, document, &seen, &urls);
+
+    url_list_t next_urls;
+    url_list_init(&next_urls);
+
+    prefetch_pool_t pool;
+    prefetch_pool_init(&pool, book, concurrency);
+    for(int depth = 0; depth < PREFETCH_MAX_DEPTH && urls.size > 0; ++depth) {
+        plutobook_resource_data_t** results = calloc(urls.size, sizeof(plutobook_resource_data_t*));
+        if(results == NULL)
+            break;
+        prefetch_pool_run(&pool, &urls, results);
+        for(size_t i = 0; i < urls.size; ++i) {
+            if(results[i] == NULL)
+                continue;
+            if(is_css_resource(urls.items[i], results[i]))
+                scan_css_urls(plutobook_resource_data_get_content(results[i]), plutobook_resource_data_get_content_length(results[i]), urls.items[i], &seen, &next_urls);
+            resource_table_insert(prefetched, urls.items[i], results[i]);
+        }
+
+        free(results);
+        url_list_t swap = urls;
+        urls = next_urls;
+        next_urls = swap;
+        url_list_clear(&next_urls);
+    }
+
+    prefetch_pool_destroy(&pool);
+    url_list_destroy(&urls);
+    url_list_destroy(&next_urls);
+    resource_table_destroy(&seen);
+}
+
+static napi_value Book_LoadUrl(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    char* url = get_string_argument(env, argv, 0);
+    if(url == NULL) {
+        return NULL;
+    }
+
+    char* userStyle = NULL;
+    char* userScript = NULL;
+
+    bool prefetch = false;
+    int64_t prefetchConcurrency = PREFETCH_DEFAULT_CONCURRENCY;
+
+    resource_table_t prefetched;
+    resource_table_init(&prefetched);
+
+    if(argc == 2) {
+        option_t options[] = {
+            {"userStyle", string_option_func, &userStyle},
+            {"userScript", string_option_func, &userScript},
+            {"prefetch", boolean_option_func, &prefetch},
+            {"prefetchConcurrency", integer_option_func, &prefetchConcurrency},
+            {NULL}
+        };
+
+        if(!parse_options(env, argv, argc, 1, options)) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    const char* user_style = userStyle ? userStyle : "";
+    const char* user_script = userScript ? userScript : "";
+
+    book_begin_load(self);
+    book_record_source(self, BOOK_SOURCE_URL, url, strlen(url), NULL, NULL, user_style, user_script, NULL);
+    if(prefetch) {
+        plutobook_resource_data_t* document = book_load_resource(self, url);
+        if(document == NULL) {
+            book_end_load(env, self, false);
+            thisArg = NULL;
+            goto cleanup;
+        }
+
+        if(prefetchConcurrency < 1)
+            prefetchConcurrency = 1;
+        if(prefetchConcurrency > PREFETCH_MAX_CONCURRENCY)
+            prefetchConcurrency = PREFETCH_MAX_CONCURRENCY;
+        prefetch_resources(self, url, document, prefetchConcurrency, &prefetched);
+        resource_table_insert(&prefetched, url, document);
+        self->prefetched = &prefetched;
+    }
+
+    if(!book_end_load(env, self, plutobook_load_url(book, url, user_style, user_script))) {
+        thisArg = NULL;
+    }
+
+    self->prefetched = NULL;
+cleanup:
+    resource_table_destroy(&prefetched);
+    free(url);
+    free(userStyle);
+    free(userScript);
+    return thisArg;
+}
+
+static napi_value Book_LoadHtml(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    char* content = get_string_argument(env, argv, 0);
+    if(content == NULL) {
+        return NULL;
+    }
+
+    char* userStyle = NULL;
+    char* userScript = NULL;
+    char* baseUrl = NULL;
+
+    if(argc == 2) {
+        option_t options[] = {
+            {"userStyle", string_option_func, &userStyle},
+            {"userScript", string_option_func, &userScript},
+            {"baseUrl", string_option_func, &baseUrl},
+            {NULL}
+        };
+
+        if(!parse_options(env, argv, argc, 1, options)) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    const char* user_style = userStyle ? userStyle : "";
+    const char* user_script = userScript ? userScript : "";
+    const char* base_url = baseUrl ? baseUrl : "";
+
+    book_begin_load(self);
+    book_record_source(self, BOOK_SOURCE_HTML, content, strlen(content), NULL, NULL, user_style, user_script, base_url);
+    if(!book_end_load(env, self, plutobook_load_html(book, content, -1, user_style, user_script, base_url))) {
+        thisArg = NULL;
+    }
+
+cleanup:
+    free(content);
+    free(userStyle);
+    free(userScript);
+    free(baseUrl);
+    return thisArg;
+}
+
+static napi_value Book_LoadXml(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    char* content = get_string_argument(env, argv, 0);
+    if(content == NULL) {
+        return NULL;
+    }
+
+    char* userStyle = NULL;
+    char* userScript = NULL;
+    char* baseUrl = NULL;
+
+    if(argc == 2) {
+        option_t options[] = {
+            {"userStyle", string_option_func, &userStyle},
+            {"userScript", string_option_func, &userScript},
+            {"baseUrl", string_option_func, &baseUrl},
+            {NULL}
+        };
+
+        if(!parse_options(env, argv, argc, 1, options)) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    const char* user_style = userStyle ? userStyle : "";
+    const char* user_script = userScript ? userScript : "";
+    const char* base_url = baseUrl ? baseUrl : "";
+
+    book_begin_load(self);
+    book_record_source(self, BOOK_SOURCE_XML, content, strlen(content), NULL, NULL, user_style, user_script, base_url);
+    if(!book_end_load(env, self, plutobook_load_xml(book, content, -1, user_style, user_script, base_url))) {
+        thisArg = NULL;
+    }
+
+cleanup:
+    free(content);
+    free(userStyle);
+    free(userScript);
+    free(baseUrl);
+    return thisArg;
+}
+
+static bool get_buffer_argument(napi_env env, napi_value* argv, size_t argi, void** buffer, size_t* length)
+{
+    if(napi_get_buffer_info(env, argv[argi], buffer, length) == napi_ok) {
+        return true;
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, argv[argi], &type);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Argument %zu must be buffer, not %s", argi + 1, type_name(type));
+    napi_throw_type_error(env, NULL, msg);
+    return false;
+}
+
+static napi_value Book_LoadData(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    void* buffer;
+    size_t length;
+    if(!get_buffer_argument(env, argv, 0, &buffer, &length)) {
+        return NULL;
+    }
+
+    char* mimeType = NULL;
+    char* textEncoding = NULL;
+    char* userStyle = NULL;
+    char* userScript = NULL;
+    char* baseUrl = NULL;
+
+    if(argc == 2) {
+        option_t options[] = {
+            {"mimeType", string_option_func, &mimeType},
+            {"textEncoding", string_option_func, &textEncoding},
+            {"userStyle", string_option_func, &userStyle},
+            {"userScript", string_option_func, &userScript},
+            {"baseUrl", string_option_func, &baseUrl},
+            {NULL}
+        };
+
+        if(!parse_options(env, argv, argc, 1, options)) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    const char* mime_type = mimeType ? mimeType : "";
+    const char* text_encoding = textEncoding ? textEncoding : "";
+    const char* user_style = userStyle ? userStyle : "";
+    const char* user_script = userScript ? userScript : "";
+    const char* base_url = baseUrl ? baseUrl : "";
+
+    book_begin_load(self);
+    book_record_source(self, BOOK_SOURCE_DATA, buffer, length, mime_type, text_encoding, user_style, user_script, base_url);
+    if(!book_end_load(env, self, plutobook_load_data(book, buffer, length, mime_type, text_encoding, user_style, user_script, base_url))) {
+        thisArg = NULL;
+    }
+
+cleanup:
+    free(mimeType);
+    free(textEncoding);
+    free(userStyle);
+    free(userScript);
+    free(baseUrl);
+    return thisArg;
+}
+
+static napi_value Book_LoadImage(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    void* buffer;
+    size_t length;
+    if(!get_buffer_argument(env, argv, 0, &buffer, &length)) {
+        return NULL;
+    }
+
+    char* mimeType = NULL;
+    char* textEncoding = NULL;
+    char* userStyle = NULL;
+    char* userScript = NULL;
+    char* baseUrl = NULL;
+
+    if(argc == 2) {
+        option_t options[] = {
+            {"mimeType", string_option_func, &mimeType},
+            {"textEncoding", string_option_func, &textEncoding},
+            {"userStyle", string_option_func, &userStyle},
+            {"userScript", string_option_func, &userScript},
+            {"baseUrl", string_option_func, &baseUrl},
+            {NULL}
+        };
+
+        if(!parse_options(env, argv, argc, 1, options)) {
+            thisArg = NULL;
+            goto cleanup;
+        }
+    }
+
+    const char* mime_type = mimeType ? mimeType : "";
+    const char* text_encoding = textEncoding ? textEncoding : "";
     const char* user_style = userStyle ? userStyle : "";
     const char* user_script = userScript ? userScript : "";
+    const char* base_url = baseUrl ? baseUrl : "";
+
+    book_begin_load(self);
+    book_record_source(self, BOOK_SOURCE_IMAGE, buffer, length, mime_type, text_encoding, user_style, user_script, base_url);
+    if(!book_end_load(env, self, plutobook_load_image(book, buffer, length, mime_type, text_encoding, user_style, user_script, base_url))) {
+        thisArg = NULL;
+    }
+
+cleanup:
+    free(mimeType);
+    free(textEncoding);
+    free(userStyle);
+    free(userScript);
+    free(baseUrl);
+    return thisArg;
+}
+
+#define FILE_STREAM_ALIGNMENT 4096
+
+typedef enum {
+    FILE_TARGET_NEW,
+    FILE_TARGET_REGULAR,
+    FILE_TARGET_SPECIAL
+} file_target_t;
+
+typedef struct {
+    int fd;
+    char* path;
+    char* target;
+    char* temp_path;
+    char* data;
+    size_t size;
+    size_t capacity;
+    size_t written;
+    bool direct;
+    bool special;
+    file_sync_t sync;
+    int error;
+} file_stream_t;
+
+#ifdef _WIN32
+static int file_open_temp(const char* path, bool direct)
+{
+    wchar_t* wpath = utf8_to_wide(path);
+    int fd = _wopen(wpath, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+    free(wpath);
+    return fd;
+}
+
+static int file_open_target(const char* path)
+{
+    wchar_t* wpath = utf8_to_wide(path);
+    int fd = _wopen(wpath, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    free(wpath);
+    return fd;
+}
+
+static bool file_resolve_target(const char* path, char** target, file_target_t* kind)
+{
+    struct _stat64 st;
+    wchar_t* wpath = utf8_to_wide(path);
+    bool exists = _wstat64(wpath, &st) == 0;
+    free(wpath);
+    if(exists && (st.st_mode & _S_IFMT) != _S_IFREG) {
+        *target = NULL;
+        *kind = FILE_TARGET_SPECIAL;
+        return true;
+    }
+
+    *target = strdup(path);
+    *kind = exists ? FILE_TARGET_REGULAR : FILE_TARGET_NEW;
+    return *target != NULL;
+}
+
+static int64_t file_write(int fd, const char* data, size_t size)
+{
+    return _write(fd, data, (unsigned int)(size > INT_MAX ? INT_MAX : size));
+}
+
+static int file_sync(int fd, file_sync_t sync)
+{
+    return _commit(fd);
+}
+
+static int file_close(int fd)
+{
+    return _close(fd);
+}
+
+static int file_rename(const char* from, const char* to)
+{
+    wchar_t* wfrom = utf8_to_wide(from);
+    wchar_t* wto = utf8_to_wide(to);
+    BOOL success = MoveFileExW(wfrom, wto, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    free(wfrom);
+    free(wto);
+    if(!success) {
+        errno = EACCES;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void file_unlink(const char* path)
+{
+    wchar_t* wpath = utf8_to_wide(path);
+    _wunlink(wpath);
+    free(wpath);
+}
+
+static void file_sync_parent(const char* path)
+{
+}
+
+static void file_copy_mode(int fd, const char* path)
+{
+}
+
+static char* file_buffer_alloc(size_t size)
+{
+    return _aligned_malloc(size, FILE_STREAM_ALIGNMENT);
+}
+
+static void file_buffer_free(char* data)
+{
+    _aligned_free(data);
+}
+#else
+static int file_open_temp(const char* path, bool direct)
+{
+    int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+#ifdef O_DIRECT
+    if(direct) {
+        int fd = open(path, flags | O_DIRECT, 0666);
+        if(fd != -1 || errno != EINVAL)
+            return fd;
+        unlink(path);
+    }
+#endif
+
+    int fd = open(path, flags, 0666);
+#ifdef F_NOCACHE
+    if(fd != -1 && direct) {
+        fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+    return fd;
+}
+
+static int file_open_target(const char* path)
+{
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+}
+
+static bool file_resolve_target(const char* path, char** target, file_target_t* kind)
+{
+    struct stat st;
+    *target = NULL;
+    if(stat(path, &st) == 0) {
+        if(!S_ISREG(st.st_mode)) {
+            *kind = FILE_TARGET_SPECIAL;
+            return true;
+        }
+
+        *kind = FILE_TARGET_REGULAR;
+        *target = realpath(path, NULL);
+        return *target != NULL;
+    }
+
+    *kind = FILE_TARGET_NEW;
+    if(lstat(path, &st) == 0)
+        return true;
+    *target = strdup(path);
+    return *target != NULL;
+}
+
+static int64_t file_write(int fd, const char* data, size_t size)
+{
+    return write(fd, data, size);
+}
+
+static int file_sync(int fd, file_sync_t sync)
+{
+#if defined(__linux__)
+    if(sync == FILE_SYNC_DATA)
+        return fdatasync(fd);
+#endif
+    return fsync(fd);
+}
+
+static int file_close(int fd)
+{
+    return close(fd);
+}
+
+static int file_rename(const char* from, const char* to)
+{
+    return rename(from, to);
+}
+
+static void file_unlink(const char* path)
+{
+    unlink(path);
+}
+
+static void file_sync_parent(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    char* directory = slash ? strndup(path, slash == path ? 1 : slash - path) : strdup(".");
+    int fd = open(directory, O_RDONLY | O_CLOEXEC);
+    if(fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+
+    free(directory);
+}
+
+static void file_copy_mode(int fd, const char* path)
+{
+    struct stat st;
+    if(stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+        fchmod(fd, st.st_mode & 07777);
+    }
+}
+
+static char* file_buffer_alloc(size_t size)
+{
+    void* data;
+    if(posix_memalign(&data, FILE_STREAM_ALIGNMENT, size) != 0)
+        return NULL;
+    return data;
+}
+
+static void file_buffer_free(char* data)
+{
+    free(data);
+}
+#endif
+
+static void file_stream_init(file_stream_t* stream)
+{
+    stream->fd = -1;
+    stream->path = NULL;
+    stream->target = NULL;
+    stream->temp_path = NULL;
+    stream->data = NULL;
+    stream->size = 0;
+    stream->capacity = 0;
+    stream->written = 0;
+    stream->direct = false;
+    stream->special = false;
+    stream->sync = FILE_SYNC_NONE;
+    stream->error = 0;
+}
+
+static volatile long file_stream_counter = 0;
+
+static bool file_stream_open_temp(file_stream_t* stream, const file_options_t* options)
+{
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+
+    size_t temp_length = strlen(stream->target) + 48;
+    stream->temp_path = malloc(temp_length);
+    if(stream->temp_path == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+
+    for(int attempt = 0; attempt < 16; ++attempt) {
+        snprintf(stream->temp_path, temp_length, "%s.%d.%ld.tmp", stream->target, pid, (long)atomic_increment(&file_stream_counter));
+        stream->fd = file_open_temp(stream->temp_path, options->directIo);
+        if(stream->fd != -1 || errno != EEXIST) {
+            break;
+        }
+    }
+
+    if(stream->fd == -1) {
+        int error = errno;
+        free(stream->temp_path);
+        stream->temp_path = NULL;
+        errno = error;
+        return false;
+    }
+
+    file_copy_mode(stream->fd, stream->target);
+    stream->direct = options->directIo;
+    return true;
+}
+
+static bool file_stream_open(file_stream_t* stream, const char* path, const file_options_t* options)
+{
+    size_t capacity = (size_t)options->bufferSize;
+    capacity = (capacity + FILE_STREAM_ALIGNMENT - 1) & ~(size_t)(FILE_STREAM_ALIGNMENT - 1);
+
+    stream->data = file_buffer_alloc(capacity);
+    stream->path = strdup(path);
+    if(stream->data == NULL || stream->path == NULL) {
+        stream->error = ENOMEM;
+        return false;
+    }
+
+    file_target_t kind;
+    if(!file_resolve_target(path, &stream->target, &kind)) {
+        stream->error = errno ? errno : ENOMEM;
+        return false;
+    }
+
+    if(stream->target && !file_stream_open_temp(stream, options)) {
+        if(kind != FILE_TARGET_REGULAR || (errno != EACCES && errno != EPERM)) {
+            stream->error = errno;
+            return false;
+        }
+
+        free(stream->target);
+        stream->target = NULL;
+    }
+
+    if(stream->target == NULL) {
+        stream->fd = file_open_target(path);
+        if(stream->fd == -1) {
+            stream->error = errno;
+            return false;
+        }
+    }
+
+    stream->capacity = capacity;
+    stream->special = kind == FILE_TARGET_SPECIAL;
+    stream->sync = options->sync;
+    return true;
+}
+
+static bool file_stream_flush(file_stream_t* stream)
+{
+    const char* data = stream->data;
+    size_t size = stream->size;
+    while(size > 0) {
+        int64_t written = file_write(stream->fd, data, size);
+        if(written < 0) {
+            if(errno == EINTR)
+                continue;
+            stream->error = errno;
+            return false;
+        }
+
+        data += written;
+        size -= written;
+    }
+
+    stream->size = 0;
+    return true;
+}
+
+static plutobook_stream_status_t file_stream_write_func(void* closure, const char* data, unsigned int length)
+{
+    file_stream_t* stream = closure;
+    stream->written += length;
+    while(length > 0) {
+        size_t count = stream->capacity - stream->size;
+        if(count > length)
+            count = length;
+        memcpy(stream->data + stream->size, data, count);
+        stream->size += count;
+        data += count;
+        length -= count;
+
+        if(stream->size == stream->capacity && !file_stream_flush(stream)) {
+            return PLUTOBOOK_STREAM_STATUS_WRITE_ERROR;
+        }
+    }
+
+    return PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+static bool file_stream_finish(file_stream_t* stream)
+{
+#if !defined(_WIN32) && defined(O_DIRECT)
+    if(stream->direct && stream->size % FILE_STREAM_ALIGNMENT) {
+        int flags = fcntl(stream->fd, F_GETFL);
+        fcntl(stream->fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+
+    if(!file_stream_flush(stream))
+        return false;
+    if(stream->sync != FILE_SYNC_NONE && !stream->special && file_sync(stream->fd, stream->sync) == -1) {
+        stream->error = errno;
+        return false;
+    }
+
+    int fd = stream->fd;
+    stream->fd = -1;
+    if(file_close(fd) == -1) {
+        stream->error = errno;
+        return false;
+    }
+
+    file_buffer_free(stream->data);
+    stream->data = NULL;
+    return true;
+}
+
+static bool file_stream_publish(file_stream_t* stream)
+{
+    if(stream->temp_path == NULL)
+        return true;
+    if(file_rename(stream->temp_path, stream->target) == -1) {
+        stream->error = errno;
+        return false;
+    }
+
+    free(stream->temp_path);
+    stream->temp_path = NULL;
+    if(stream->sync == FILE_SYNC_FULL)
+        file_sync_parent(stream->target);
+    return true;
+}
+
+static bool file_stream_commit(file_stream_t* stream)
+{
+    return file_stream_finish(stream) && file_stream_publish(stream);
+}
+
+static void file_stream_destroy(file_stream_t* stream)
+{
+    if(stream->fd != -1)
+        file_close(stream->fd);
+    if(stream->temp_path) {
+        file_unlink(stream->temp_path);
+    }
+
+    file_buffer_free(stream->data);
+    free(stream->temp_path);
+    free(stream->target);
+    free(stream->path);
+}
+
+static void throw_file_stream_error(napi_env env, const file_stream_t* stream)
+{
+    if(stream->error == 0) {
+        napi_throw_error(env, NULL, plutobook_get_error_message());
+        return;
+    }
+
+    char msg[512];
+    snprintf(msg, sizeof(msg), "Unable to write \"%s\": %s", stream->path ? stream->path : "", strerror(stream->error));
+    napi_throw_error(env, NULL, msg);
+}
+
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t size;
+} target_stream_t;
+
+static void target_stream_init(target_stream_t* stream, void* data, size_t capacity)
+{
+    stream->data = data;
+    stream->capacity = capacity;
+    stream->size = 0;
+}
+
+static plutobook_stream_status_t target_stream_write_func(void* closure, const char* data, unsigned int length)
+{
+    target_stream_t* stream = closure;
+    if(stream->size <= stream->capacity && length <= stream->capacity - stream->size)
+        memcpy(stream->data + stream->size, data, length);
+    stream->size += length;
+    return PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+static size_t typedarray_element_size(napi_typedarray_type type)
+{
+    switch(type) {
+    case napi_int16_array:
+    case napi_uint16_array:
+        return 2;
+    case napi_int32_array:
+    case napi_uint32_array:
+    case napi_float32_array:
+        return 4;
+    case napi_float64_array:
+    case napi_bigint64_array:
+    case napi_biguint64_array:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+static bool get_target_argument(napi_env env, napi_value* argv, size_t argi, void** data, size_t* length)
+{
+    bool is_typedarray;
+    napi_is_typedarray(env, argv[argi], &is_typedarray);
+    if(is_typedarray) {
+        napi_typedarray_type type;
+        size_t element_count;
+        napi_get_typedarray_info(env, argv[argi], &type, &element_count, data, NULL, NULL);
+        *length = element_count * typedarray_element_size(type);
+        return true;
+    }
+
+    bool is_arraybuffer;
+    napi_is_arraybuffer(env, argv[argi], &is_arraybuffer);
+    if(is_arraybuffer) {
+        napi_get_arraybuffer_info(env, argv[argi], data, length);
+        return true;
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, argv[argi], &type);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Argument %zu must be buffer, typed array or array buffer, not %s", argi + 1, type_name(type));
+    napi_throw_type_error(env, NULL, msg);
+    return false;
+}
+
+static bool check_target_size(napi_env env, size_t required, size_t length)
+{
+    if(required <= length)
+        return true;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Target buffer of %zu bytes is too small, %zu bytes required", length, required);
+
+    napi_value code, message, error, property;
+    napi_create_string_utf8(env, "ERR_BUFFER_TOO_SMALL", NAPI_AUTO_LENGTH, &code);
+    napi_create_string_utf8(env, msg, NAPI_AUTO_LENGTH, &message);
+    napi_create_range_error(env, code, message, &error);
+    napi_create_int64(env, required, &property);
+    napi_set_named_property(env, error, "required", property);
+    napi_throw(env, error);
+    return false;
+}
+
+static napi_value Book_WriteToPdf(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    char* path = get_string_argument(env, argv, 0);
+    if(path == NULL) {
+        return NULL;
+    }
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    file_stream_t stream;
+    file_stream_init(&stream);
+
+    pdf_options_t local_options;
+    pdf_options_init(&local_options);
+
+    const pdf_options_t* options = &local_options;
+    if(argc == 2) {
+        options = get_pdf_options(env, argv, argc, 1, &local_options, true);
+        if(options == NULL) {
+            goto cleanup;
+        }
+    }
+
+    if(!file_stream_open(&stream, path, &options->file)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    if(!plutobook_write_to_pdf_stream_range(book, file_stream_write_func, &stream, options->pageStart, options->pageEnd, options->pageStep)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    if(!file_stream_commit(&stream)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    napi_get_undefined(env, &result);
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_PDF, start_time, stream.written, result != NULL);
+    file_stream_destroy(&stream);
+    free(path);
+    return result;
+}
+
+static napi_value Book_WriteToPdfBuffer(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    memory_stream_t stream;
+    memory_stream_init(&stream);
+
+    pdf_options_t local_options;
+    pdf_options_init(&local_options);
+
+    const pdf_options_t* options = &local_options;
+    if(argc == 1) {
+        options = get_pdf_options(env, argv, argc, 0, &local_options, false);
+        if(options == NULL) {
+            goto cleanup;
+        }
+    }
+
+    if(!plutobook_write_to_pdf_stream_range(book, stream_write_func, &stream, options->pageStart, options->pageEnd, options->pageStep)) {
+        napi_throw_error(env, NULL, plutobook_get_error_message());
+        goto cleanup;
+    }
+
+    napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_PDF, start_time, stream.size, result != NULL);
+    memory_stream_destroy(&stream);
+    return result;
+}
+
+static napi_value Book_WriteToPdfInto(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    void* data;
+    size_t length;
+    if(!get_target_argument(env, argv, 0, &data, &length)) {
+        return NULL;
+    }
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    target_stream_t stream;
+    target_stream_init(&stream, data, length);
+
+    pdf_options_t local_options;
+    pdf_options_init(&local_options);
+
+    const pdf_options_t* options = &local_options;
+    if(argc == 2) {
+        options = get_pdf_options(env, argv, argc, 1, &local_options, false);
+        if(options == NULL) {
+            goto cleanup;
+        }
+    }
+
+    if(!plutobook_write_to_pdf_stream_range(book, target_stream_write_func, &stream, options->pageStart, options->pageEnd, options->pageStep)) {
+        napi_throw_error(env, NULL, plutobook_get_error_message());
+        goto cleanup;
+    }
+
+    if(!check_target_size(env, stream.size, length)) {
+        goto cleanup;
+    }
+
+    napi_create_int64(env, stream.size, &result);
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_PDF, start_time, stream.size, result != NULL);
+    return result;
+}
+
+typedef bool (*page_func_t)(void* closure, unsigned int page_index);
+
+static bool write_pdf_pages(const plutobook_t* book, plutobook_stream_write_callback_t callback, void* closure, const pdf_options_t* options, page_func_t page_func, void* page_closure)
+{
+    int64_t page_count = plutobook_get_page_count(book);
+    if(page_count == 0) {
+        plutobook_set_error_message("Document has no pages");
+        return false;
+    }
+
+    if(options->pageStep == 0) {
+        plutobook_set_error_message("Invalid page step 0");
+        return false;
+    }
+
+    int64_t from_page = options->pageStart < 1 ? 1 : options->pageStart > page_count ? page_count : options->pageStart;
+    int64_t to_page = options->pageEnd < 1 ? 1 : options->pageEnd > page_count ? page_count : options->pageEnd;
+
+    plutobook_canvas_t* canvas = plutobook_pdf_canvas_create_for_stream(callback, closure, plutobook_get_page_size(book));
+    if(canvas == NULL)
+        return false;
+    static const plutobook_pdf_metadata_t metadatas[] = {
+        PLUTOBOOK_PDF_METADATA_TITLE,
+        PLUTOBOOK_PDF_METADATA_AUTHOR,
+        PLUTOBOOK_PDF_METADATA_SUBJECT,
+        PLUTOBOOK_PDF_METADATA_KEYWORDS,
+        PLUTOBOOK_PDF_METADATA_CREATOR,
+        PLUTOBOOK_PDF_METADATA_CREATION_DATE,
+        PLUTOBOOK_PDF_METADATA_MODIFICATION_DATE
+    };
+
+    for(size_t i = 0; i < sizeof(metadatas) / sizeof(metadatas[0]); ++i) {
+        const char* value = plutobook_get_metadata(book, metadatas[i]);
+        if(value && *value) {
+            plutobook_pdf_canvas_set_metadata(canvas, metadatas[i], value);
+        }
+    }
+
+    for(int64_t page = from_page; options->pageStep > 0 ? page <= to_page : page >= to_page; page += options->pageStep) {
+        unsigned int page_index = page - 1;
+        plutobook_pdf_canvas_set_size(canvas, plutobook_get_page_size_at(book, page_index));
+        plutobook_canvas_save_state(canvas);
+        plutobook_canvas_scale(canvas, PLUTOBOOK_UNITS_PX, PLUTOBOOK_UNITS_PX);
+        plutobook_render_page(book, canvas, page_index);
+        plutobook_canvas_restore_state(canvas);
+        plutobook_pdf_canvas_show_page(canvas);
+        if(page_func && !page_func(page_closure, page_index)) {
+            plutobook_canvas_destroy(canvas);
+            return false;
+        }
+    }
+
+    plutobook_canvas_finish(canvas);
+    plutobook_canvas_destroy(canvas);
+    return true;
+}
+
+#define PDF_ASYNC_MAX_QUEUED_PAGES 4
+
+typedef struct {
+    unsigned int page_index;
+    size_t byte_offset;
+    double elapsed;
+    char* data;
+    size_t size;
+} pdf_page_event_t;
+
+typedef struct {
+    napi_async_work work;
+    napi_deferred deferred;
+    napi_threadsafe_function tsfn;
+    napi_ref book_ref;
+    napi_ref error_ref;
+    book_t* book;
+    pdf_options_t options;
+    memory_stream_t stream;
+    size_t emitted;
+    uint64_t start_time;
+    bool success;
+    bool has_callback;
+    volatile int cancelled;
+    char* error_message;
+} pdf_async_t;
+
+static bool pdf_async_page_func(void* closure, unsigned int page_index)
+{
+    pdf_async_t* async = closure;
+    if(async->cancelled) {
+        plutobook_set_error_message("Export cancelled by onPage");
+        return false;
+    }
+
+    pdf_page_event_t* event = malloc(sizeof(pdf_page_event_t));
+    if(event == NULL) {
+        plutobook_set_error_message("%s", strerror(ENOMEM));
+        return false;
+    }
+
+    event->page_index = page_index;
+    event->byte_offset = async->emitted;
+    event->elapsed = (uv_hrtime() - async->start_time) / 1e6;
+    event->size = async->stream.size - async->emitted;
+    event->data = malloc(event->size ? event->size : 1);
+    if(event->data == NULL) {
+        plutobook_set_error_message("%s", strerror(ENOMEM));
+        free(event);
+        return false;
+    }
+
+    memcpy(event->data, async->stream.data + async->emitted, event->size);
+    async->emitted = async->stream.size;
+    if(napi_call_threadsafe_function(async->tsfn, event, napi_tsfn_blocking) != napi_ok) {
+        free(event->data);
+        free(event);
+    }
+
+    return true;
+}
+
+static void pdf_async_call_js(napi_env env, napi_value js_callback, void* context, void* data)
+{
+    pdf_async_t* async = context;
+    pdf_page_event_t* event = data;
+    if(env == NULL || js_callback == NULL || async->error_ref) {
+        free(event->data);
+        free(event);
+        return;
+    }
+
+    napi_value object, value;
+    napi_create_object(env, &object);
+    napi_create_uint32(env, event->page_index, &value);
+    napi_set_named_property(env, object, "pageIndex", value);
+    napi_create_double(env, event->byte_offset, &value);
+    napi_set_named_property(env, object, "byteOffset", value);
+    napi_create_double(env, event->elapsed, &value);
+    napi_set_named_property(env, object, "elapsed", value);
+    napi_create_buffer_copy(env, event->size, event->data, NULL, &value);
+    napi_set_named_property(env, object, "data", value);
+    free(event->data);
+    free(event);
+
+    napi_value undefined;
+    napi_get_undefined(env, &undefined);
+    if(napi_call_function(env, undefined, js_callback, 1, &object, NULL) == napi_pending_exception) {
+        napi_value exception;
+        napi_get_and_clear_last_exception(env, &exception);
+        napi_create_reference(env, exception, 1, &async->error_ref);
+        async->cancelled = true;
+    }
+}
+
+static void pdf_async_execute(napi_env env, void* data)
+{
+    pdf_async_t* async = data;
+    async->start_time = uv_hrtime();
+    page_func_t page_func = async->has_callback ? pdf_async_page_func : NULL;
+    async->success = write_pdf_pages(async->book->book, stream_write_func, &async->stream, &async->options, page_func, async);
+    if(!async->success) {
+        async->error_message = copy_string(plutobook_get_error_message(), strlen(plutobook_get_error_message()));
+    }
+}
+
+static void pdf_async_complete(napi_env env, napi_status status, void* data)
+{
+    pdf_async_t* async = data;
+    napi_release_threadsafe_function(async->tsfn, napi_tsfn_release);
+}
+
+static void pdf_async_finalize(napi_env env, void* data, void* hint)
+{
+    pdf_async_t* async = data;
+    async->book->busy = false;
+    metrics_record_render(METRIC_OUTPUT_PDF, async->start_time, async->stream.size, async->success && async->error_ref == NULL);
+
+    if(async->error_ref) {
+        napi_value exception;
+        napi_get_reference_value(env, async->error_ref, &exception);
+        napi_reject_deferred(env, async->deferred, exception);
+        napi_delete_reference(env, async->error_ref);
+    } else if(!async->success) {
+        napi_value message, error;
+        napi_create_string_utf8(env, async->error_message ? async->error_message : strerror(ENOMEM), NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, async->deferred, error);
+    } else {
+        napi_value result;
+        napi_create_buffer_copy(env, async->stream.size, async->stream.data, NULL, &result);
+        napi_resolve_deferred(env, async->deferred, result);
+    }
+
+    napi_delete_async_work(env, async->work);
+    napi_delete_reference(env, async->book_ref);
+    memory_stream_destroy(&async->stream);
+    free(async->error_message);
+    free(async);
+}
+
+static napi_value Book_WriteToPdfAsync(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    pdf_options_t options;
+    pdf_options_init(&options);
+
+    napi_value onPage = NULL;
+    if(argc == 1) {
+        const pdf_options_t* handle_options = get_pdf_options(env, argv, argc, 0, &options, false);
+        if(handle_options == NULL)
+            return NULL;
+        options = *handle_options;
+
+        napi_valuetype type;
+        napi_typeof(env, argv[0], &type);
+        if(type == napi_object) {
+            option_t async_options[] = {
+                {"onPage", function_option_func, &onPage},
+                {NULL}
+            };
+
+            if(!parse_options(env, argv, argc, 0, async_options)) {
+                return NULL;
+            }
+        }
+    }
+
+    pdf_async_t* async = calloc(1, sizeof(pdf_async_t));
+    async->book = self;
+    async->options = options;
+    async->has_callback = onPage != NULL;
+    memory_stream_init(&async->stream);
+
+    napi_value promise, resource_name;
+    napi_create_promise(env, &async->deferred, &promise);
+    napi_create_string_utf8(env, "plutoprint:writeToPdfAsync", NAPI_AUTO_LENGTH, &resource_name);
+    napi_create_reference(env, thisArg, 1, &async->book_ref);
+    napi_create_threadsafe_function(env, onPage, NULL, resource_name, PDF_ASYNC_MAX_QUEUED_PAGES, 1, async, pdf_async_finalize, async, pdf_async_call_js, &async->tsfn);
+    napi_create_async_work(env, NULL, resource_name, pdf_async_execute, pdf_async_complete, async, &async->work);
+    napi_queue_async_work(env, async->work);
+
+    self->busy = true;
+    return promise;
+}
+
+typedef struct {
+    int64_t start;
+    int64_t end;
+} page_range_t;
+
+typedef struct {
+    page_range_t* data;
+    size_t size;
+} page_range_list_t;
+
+static bool ranges_option_func(napi_env env, napi_value property, const char* name, void* result)
+{
+    page_range_list_t* ranges = result;
+
+    bool is_array;
+    napi_is_array(env, property, &is_array);
+    if(!is_array) {
+        napi_valuetype type;
+        napi_typeof(env, property, &type);
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Property `%s` must be array, not %s", name, type_name(type));
+        napi_throw_type_error(env, NULL, msg);
+        return false;
+    }
+
+    uint32_t length;
+    napi_get_array_length(env, property, &length);
+
+    free(ranges->data);
+    ranges->data = malloc((length ? length : 1) * sizeof(page_range_t));
+    ranges->size = 0;
+    if(ranges->data == NULL) {
+        napi_throw_error(env, NULL, strerror(ENOMEM));
+        return false;
+    }
+
+    for(uint32_t i = 0; i < length; ++i) {
+        napi_value element, start, end;
+        napi_get_element(env, property, i, &element);
+
+        uint32_t element_length = 0;
+        napi_is_array(env, element, &is_array);
+        if(is_array)
+            napi_get_array_length(env, element, &element_length);
+        page_range_t* range = &ranges->data[ranges->size];
+        if(element_length == 2) {
+            napi_get_element(env, element, 0, &start);
+            napi_get_element(env, element, 1, &end);
+            if(napi_get_value_int64(env, start, &range->start) == napi_ok
+                && napi_get_value_int64(env, end, &range->end) == napi_ok) {
+                ranges->size++;
+                continue;
+            }
+        }
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Property `%s` must contain only [start, end] number pairs", name);
+        napi_throw_type_error(env, NULL, msg);
+        return false;
+    }
+
+    return true;
+}
+
+static char* format_part_path(const char* pattern, size_t part)
+{
+    const char* placeholder = strstr(pattern, "%d");
+    char number[32];
+    int number_length = snprintf(number, sizeof(number), "%zu", part);
+    size_t prefix_length = placeholder - pattern;
+    size_t suffix_length = strlen(placeholder + 2);
+    char* path = malloc(prefix_length + number_length + suffix_length + 1);
+    if(path == NULL)
+        return NULL;
+    memcpy(path, pattern, prefix_length);
+    memcpy(path + prefix_length, number, number_length);
+    memcpy(path + prefix_length + number_length, placeholder + 2, suffix_length + 1);
+    return path;
+}
+
+static napi_value Book_SplitToPdf(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+    size_t bytes = 0;
+
+    page_range_list_t ranges = {NULL, 0};
+    int64_t every = 0;
+    char* path = NULL;
+    file_stream_t* streams = NULL;
+    size_t stream_count = 0;
+
+    pdf_options_t pdf_options;
+    pdf_options_init(&pdf_options);
+
+    option_t options[] = {
+        {"ranges", ranges_option_func, &ranges},
+        {"every", integer_option_func, &every},
+        {"path", string_option_func, &path},
+        {NULL}
+    };
+
+    if(!parse_options(env, argv, argc, 0, options)) {
+        goto cleanup;
+    }
+
+    if(path && !parse_file_options(env, argv, argc, 0, &pdf_options.file)) {
+        goto cleanup;
+    }
+
+    if((ranges.data == NULL) == (every == 0)) {
+        napi_throw_type_error(env, NULL, "Exactly one of `ranges` or `every` must be specified");
+        goto cleanup;
+    }
+
+    if(path && strstr(path, "%d") == NULL) {
+        napi_throw_type_error(env, NULL, "Property `path` must contain a %d placeholder for the part number");
+        goto cleanup;
+    }
+
+    int64_t page_count = plutobook_get_page_count(book);
+    if(every != 0) {
+        if(every < 0) {
+            napi_throw_range_error(env, NULL, "Property `every` must be greater than 0");
+            goto cleanup;
+        }
+
+        if(every > page_count)
+            every = page_count > 0 ? page_count : 1;
+        ranges.size = (page_count + every - 1) / every;
+        ranges.data = malloc((ranges.size ? ranges.size : 1) * sizeof(page_range_t));
+        if(ranges.data == NULL) {
+            napi_throw_error(env, NULL, strerror(ENOMEM));
+            goto cleanup;
+        }
+
+        for(size_t i = 0; i < ranges.size; ++i) {
+            int64_t start = i * every;
+            ranges.data[i].start = start + 1;
+            ranges.data[i].end = start + every < page_count ? start + every : page_count;
+        }
+    }
+
+    for(size_t i = 0; i < ranges.size; ++i) {
+        if(ranges.data[i].start < 1 || ranges.data[i].start > ranges.data[i].end || ranges.data[i].end > page_count) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Page range [%lld, %lld] is out of range [1, %lld]", (long long)ranges.data[i].start, (long long)ranges.data[i].end, (long long)page_count);
+            napi_throw_range_error(env, NULL, msg);
+            goto cleanup;
+        }
+    }
+
+    if(path) {
+        streams = malloc((ranges.size ? ranges.size : 1) * sizeof(file_stream_t));
+        if(streams == NULL) {
+            napi_throw_error(env, NULL, strerror(ENOMEM));
+            goto cleanup;
+        }
+    }
+
+    napi_value parts;
+    napi_create_array_with_length(env, ranges.size, &parts);
+    for(size_t i = 0; i < ranges.size; ++i) {
+        pdf_options.pageStart = ranges.data[i].start;
+        pdf_options.pageEnd = ranges.data[i].end;
+        pdf_options.pageStep = 1;
+
+        if(path) {
+            file_stream_t* stream = &streams[stream_count++];
+            file_stream_init(stream);
+
+            char* part_path = format_part_path(path, i + 1);
+            if(part_path == NULL) {
+                napi_throw_error(env, NULL, strerror(ENOMEM));
+                goto cleanup;
+            }
+
+            bool success = file_stream_open(stream, part_path, &pdf_options.file)
+                && write_pdf_pages(book, file_stream_write_func, stream, &pdf_options, NULL, NULL)
+                && file_stream_finish(stream);
+            bytes += stream->written;
+            free(part_path);
+            if(!success) {
+                throw_file_stream_error(env, stream);
+                goto cleanup;
+            }
+        } else {
+            napi_value part;
+            memory_stream_t stream;
+            memory_stream_init(&stream);
+            bool success = write_pdf_pages(book, stream_write_func, &stream, &pdf_options, NULL, NULL);
+            bytes += stream.size;
+            if(!success)
+                napi_throw_error(env, NULL, plutobook_get_error_message());
+            else
+                napi_create_buffer_copy(env, stream.size, stream.data, NULL, &part);
+            memory_stream_destroy(&stream);
+            if(!success) {
+                goto cleanup;
+            }
+
+            napi_set_element(env, parts, i, part);
+        }
+    }
+
+    for(size_t i = 0; i < stream_count; ++i) {
+        if(!file_stream_publish(&streams[i])) {
+            throw_file_stream_error(env, &streams[i]);
+            goto cleanup;
+        }
+
+        napi_value part;
+        napi_create_string_utf8(env, streams[i].path, NAPI_AUTO_LENGTH, &part);
+        napi_set_element(env, parts, i, part);
+    }
+
+    result = parts;
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_PDF, start_time, bytes, result != NULL);
+    for(size_t i = 0; i < stream_count; ++i)
+        file_stream_destroy(&streams[i]);
+    free(streams);
+    free(ranges.data);
+    free(path);
+    return result;
+}
+
+static bool check_png_limits(napi_env env, book_t* self, const png_options_t* options)
+{
+    image_size_t size;
+    if(!get_document_image_size(self->book, options->width, options->height, options->scale, &size))
+        return true;
+    return check_book_limit(env, self, BOOK_LIMIT_MAX_CANVAS_PIXELS, size.canvas_width * size.canvas_height);
+}
+
+static bool write_png_stream(const plutobook_t* book, const png_options_t* options, plutobook_stream_write_callback_t callback, void* closure)
+{
+    plutobook_canvas_t* canvas = render_document_image(book, options->width, options->height, options->scale);
+    if(canvas == NULL)
+        return false;
+    bool success;
+    if(options->compressionLevel != -1 || options->filter != PNG_FILTER_DEFAULT || options->colorType != PNG_COLOR_DEFAULT)
+        success = encode_png_canvas(canvas, options, callback, closure);
+    else
+        success = plutobook_image_canvas_write_to_png_stream(canvas, callback, closure);
+    plutobook_canvas_destroy(canvas);
+    return success;
+}
+
+static napi_value Book_WriteToPng(napi_env env, napi_callback_info info)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    char* path = get_string_argument(env, argv, 0);
+    if(path == NULL) {
+        return NULL;
+    }
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    file_stream_t stream;
+    file_stream_init(&stream);
+
+    png_options_t local_options;
+    png_options_init(&local_options);
+
+    const png_options_t* options = &local_options;
+    if(argc == 2) {
+        options = get_png_options(env, argv, argc, 1, &local_options, true);
+        if(options == NULL) {
+            goto cleanup;
+        }
+    }
+
+    if(!check_png_limits(env, self, options)) {
+        goto cleanup;
+    }
+
+    if(!file_stream_open(&stream, path, &options->file)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    if(!write_png_stream(book, options, file_stream_write_func, &stream)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    if(!file_stream_commit(&stream)) {
+        throw_file_stream_error(env, &stream);
+        goto cleanup;
+    }
+
+    napi_get_undefined(env, &result);
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_PNG, start_time, stream.written, result != NULL);
+    file_stream_destroy(&stream);
+    free(path);
+    return result;
+}
+
+static napi_value Book_WriteToPngBuffer(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    napi_value thisArg;
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+        return NULL;
+    }
+
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    memory_stream_t stream;
+    memory_stream_init(&stream);
+
+    png_options_t local_options;
+    png_options_init(&local_options);
+
+    const png_options_t* options = &local_options;
+    if(argc == 1) {
+        options = get_png_options(env, argv, argc, 0, &local_options, false);
+        if(options == NULL) {
+            goto cleanup;
+        }
+    }
+
+    if(!check_png_limits(env, self, options)) {
+        goto cleanup;
+    }
 
-    if(!plutobook_load_url(book, url, user_style, user_script)) {
+    if(!write_png_stream(book, options, stream_write_func, &stream)) {
         napi_throw_error(env, NULL, plutobook_get_error_message());
-        thisArg = NULL;
+        goto cleanup;
     }
 
+    napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
 cleanup:
-    free(url);
-    free(userStyle);
-    free(userScript);
-    return thisArg;
+    metrics_record_render(METRIC_OUTPUT_PNG, start_time, stream.size, result != NULL);
+    memory_stream_destroy(&stream);
+    return result;
 }
 
-static napi_value Book_LoadHtml(napi_env env, napi_callback_info info)
+static napi_value Book_WriteToPngInto(napi_env env, napi_callback_info info)
 {
     size_t argc = 2;
     napi_value argv[2];
@@ -573,115 +5383,208 @@ static napi_value Book_LoadHtml(napi_env env, napi_callback_info info)
         return NULL;
     }
 
-    char* content = get_string_argument(env, argv, 0);
-    if(content == NULL) {
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
         return NULL;
     }
 
-    char* userStyle = NULL;
-    char* userScript = NULL;
-    char* baseUrl = NULL;
+    plutobook_t* book = self->book;
 
-    if(argc == 2) {
-        option_t options[] = {
-            {"userStyle", string_option_func, &userStyle},
-            {"userScript", string_option_func, &userScript},
-            {"baseUrl", string_option_func, &baseUrl},
-            {NULL}
-        };
+    void* data;
+    size_t length;
+    if(!get_target_argument(env, argv, 0, &data, &length)) {
+        return NULL;
+    }
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            thisArg = NULL;
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+
+    target_stream_t stream;
+    target_stream_init(&stream, data, length);
+
+    png_options_t local_options;
+    png_options_init(&local_options);
+
+    const png_options_t* options = &local_options;
+    if(argc == 2) {
+        options = get_png_options(env, argv, argc, 1, &local_options, false);
+        if(options == NULL) {
             goto cleanup;
         }
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
-
-    const char* user_style = userStyle ? userStyle : "";
-    const char* user_script = userScript ? userScript : "";
-    const char* base_url = baseUrl ? baseUrl : "";
+    if(!check_png_limits(env, self, options)) {
+        goto cleanup;
+    }
 
-    if(!plutobook_load_html(book, content, -1, user_style, user_script, base_url)) {
+    if(!write_png_stream(book, options, target_stream_write_func, &stream)) {
         napi_throw_error(env, NULL, plutobook_get_error_message());
-        thisArg = NULL;
+        goto cleanup;
+    }
+
+    if(!check_target_size(env, stream.size, length)) {
+        goto cleanup;
     }
 
+    napi_create_int64(env, stream.size, &result);
 cleanup:
-    free(userStyle);
-    free(userScript);
-    free(baseUrl);
-    return thisArg;
+    metrics_record_render(METRIC_OUTPUT_PNG, start_time, stream.size, result != NULL);
+    return result;
 }
 
-static napi_value Book_LoadXml(napi_env env, napi_callback_info info)
+typedef enum {
+    REGION_FORMAT_PNG,
+    REGION_FORMAT_RAW
+} region_format_t;
+
+static bool region_format_option_func(napi_env env, napi_value property, const char* name, void* result)
 {
-    size_t argc = 2;
-    napi_value argv[2];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
-        return NULL;
+    char* value;
+    if(!string_option_func(env, property, name, &value))
+        return false;
+    struct {
+        const char* name;
+        region_format_t value;
+    } table[] = {
+        {"png", REGION_FORMAT_PNG},
+        {"raw", REGION_FORMAT_RAW},
+        {NULL}
+    };
+
+    for(int i = 0; table[i].name; ++i) {
+        if(striequals(table[i].name, value)) {
+            *(region_format_t*)(result) = table[i].value;
+            free(value);
+            return true;
+        }
     }
 
-    char* content = get_string_argument(env, argv, 0);
-    if(content == NULL) {
-        return NULL;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Property `%s` has invalid value \"%s\"", name, value);
+    napi_throw_type_error(env, NULL, msg);
+    free(value);
+    return false;
+}
+
+typedef struct {
+    double x;
+    double y;
+    double width;
+    double height;
+    double scale;
+    region_format_t format;
+    int canvas_width;
+    int canvas_height;
+} region_options_t;
+
+#define REGION_MAX_DIMENSION 32767
+#define REGION_MAX_PIXELS (1 << 28)
+
+static bool get_region_arguments(napi_env env, book_t* self, napi_value* argv, size_t argc, size_t argi, int64_t* page_index, region_options_t* region)
+{
+    const plutobook_t* book = self->book;
+    if(!get_integer_argument(env, argv, argi, page_index)) {
+        return false;
     }
 
-    char* userStyle = NULL;
-    char* userScript = NULL;
-    char* baseUrl = NULL;
+    unsigned int page_count = plutobook_get_page_count(book);
+    if(*page_index < 0 || *page_index >= page_count) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Page index %lld is out of range [0, %u)", (long long)*page_index, page_count);
+        napi_throw_range_error(env, NULL, msg);
+        return false;
+    }
 
-    if(argc == 2) {
+    plutobook_page_size_t page_size = plutobook_get_page_size_at(book, *page_index);
+
+    region->x = 0;
+    region->y = 0;
+    region->width = -1;
+    region->height = -1;
+    region->scale = 1;
+    region->format = REGION_FORMAT_PNG;
+
+    if(argc == argi + 2) {
         option_t options[] = {
-            {"userStyle", string_option_func, &userStyle},
-            {"userScript", string_option_func, &userScript},
-            {"baseUrl", string_option_func, &baseUrl},
+            {"x", number_option_func, &region->x},
+            {"y", number_option_func, &region->y},
+            {"width", number_option_func, &region->width},
+            {"height", number_option_func, &region->height},
+            {"scale", number_option_func, &region->scale},
+            {"format", region_format_option_func, &region->format},
             {NULL}
         };
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            thisArg = NULL;
-            goto cleanup;
+        if(!parse_options(env, argv, argc, argi + 1, options)) {
+            return false;
         }
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    if(region->width == -1)
+        region->width = page_size.width / PLUTOBOOK_UNITS_PX - region->x;
+    if(region->height == -1)
+        region->height = page_size.height / PLUTOBOOK_UNITS_PX - region->y;
+    if(!(region->scale > 0)) {
+        napi_throw_range_error(env, NULL, "Property `scale` must be greater than 0");
+        return false;
+    }
 
-    const char* user_style = userStyle ? userStyle : "";
-    const char* user_script = userScript ? userScript : "";
-    const char* base_url = baseUrl ? baseUrl : "";
+    double canvas_width = ceil(region->width * region->scale);
+    double canvas_height = ceil(region->height * region->scale);
+    if(!check_book_limit(env, self, BOOK_LIMIT_MAX_CANVAS_PIXELS, canvas_width * canvas_height)) {
+        return false;
+    }
 
-    if(!plutobook_load_xml(book, content, -1, user_style, user_script, base_url)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
-        thisArg = NULL;
+    if(canvas_width < 1 || canvas_height < 1 || canvas_width > REGION_MAX_DIMENSION || canvas_height > REGION_MAX_DIMENSION) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Invalid region size %.0fx%.0f, each side must be between 1 and %d pixels", canvas_width, canvas_height, REGION_MAX_DIMENSION);
+        napi_throw_range_error(env, NULL, msg);
+        return false;
     }
 
-cleanup:
-    free(userStyle);
-    free(userScript);
-    free(baseUrl);
-    return thisArg;
+    if(canvas_width * canvas_height > REGION_MAX_PIXELS) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Region of %.0fx%.0f pixels exceeds the maximum of %d pixels", canvas_width, canvas_height, REGION_MAX_PIXELS);
+        napi_throw_range_error(env, NULL, msg);
+        return false;
+    }
+
+    region->canvas_width = canvas_width;
+    region->canvas_height = canvas_height;
+    return true;
 }
 
-static bool get_buffer_argument(napi_env env, napi_value* argv, size_t argi, void** buffer, size_t* length)
+static plutobook_canvas_t* render_page_region(const plutobook_t* book, unsigned int page_index, const region_options_t* region, unsigned char* data)
 {
-    if(napi_get_buffer_info(env, argv[argi], buffer, length) == napi_ok) {
-        return true;
+    plutobook_canvas_t* canvas;
+    if(data) {
+        int stride = region->canvas_width * 4;
+        memset(data, 0, (size_t)stride * region->canvas_height);
+        canvas = plutobook_image_canvas_create_for_data(data, region->canvas_width, region->canvas_height, stride, PLUTOBOOK_IMAGE_FORMAT_ARGB32);
+    } else {
+        canvas = plutobook_image_canvas_create(region->canvas_width, region->canvas_height, PLUTOBOOK_IMAGE_FORMAT_ARGB32);
     }
 
-    napi_valuetype type;
-    napi_typeof(env, argv[argi], &type);
+    if(canvas == NULL)
+        return NULL;
+    plutobook_canvas_scale(canvas, region->scale, region->scale);
+    plutobook_canvas_translate(canvas, -region->x, -region->y);
+    plutobook_canvas_clip_rect(canvas, region->x, region->y, region->width, region->height);
+    plutobook_render_page(book, canvas, page_index);
+    return canvas;
+}
 
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Argument %zu must be buffer, not %s", argi + 1, type_name(type));
-    napi_throw_type_error(env, NULL, msg);
-    return false;
+static bool write_page_region(const plutobook_t* book, unsigned int page_index, const region_options_t* region, unsigned char* pixels, plutobook_stream_write_callback_t callback, void* closure)
+{
+    plutobook_canvas_t* canvas = render_page_region(book, page_index, region, pixels);
+    if(canvas == NULL)
+        return false;
+    bool success = pixels || plutobook_image_canvas_write_to_png_stream(canvas, callback, closure);
+    plutobook_canvas_destroy(canvas);
+    return success;
 }
 
-static napi_value Book_LoadData(napi_env env, napi_callback_info info)
+static napi_value Book_RenderRegion(napi_env env, napi_callback_info info)
 {
     size_t argc = 2;
     napi_value argv[2];
@@ -690,339 +5593,544 @@ static napi_value Book_LoadData(napi_env env, napi_callback_info info)
         return NULL;
     }
 
-    void* buffer;
-    size_t length;
-    if(!get_buffer_argument(env, argv, 0, &buffer, &length)) {
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
         return NULL;
     }
 
-    char* mimeType = NULL;
-    char* textEncoding = NULL;
-    char* userStyle = NULL;
-    char* userScript = NULL;
-    char* baseUrl = NULL;
+    plutobook_t* book = self->book;
 
-    if(argc == 2) {
-        option_t options[] = {
-            {"mimeType", string_option_func, &mimeType},
-            {"textEncoding", string_option_func, &textEncoding},
-            {"userStyle", string_option_func, &userStyle},
-            {"userScript", string_option_func, &userScript},
-            {"baseUrl", string_option_func, &baseUrl},
-            {NULL}
-        };
+    int64_t pageIndex;
+    region_options_t region;
+    if(!get_region_arguments(env, self, argv, argc, 0, &pageIndex, &region)) {
+        return NULL;
+    }
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            thisArg = NULL;
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
+    size_t bytes = 0;
+
+    memory_stream_t stream;
+    memory_stream_init(&stream);
+
+    if(region.format == REGION_FORMAT_RAW) {
+        void* data;
+        napi_value buffer;
+        bytes = (size_t)region.canvas_width * 4 * region.canvas_height;
+        if(napi_create_buffer(env, bytes, &data, &buffer) != napi_ok) {
+            bool is_pending;
+            napi_is_exception_pending(env, &is_pending);
+            if(is_pending) {
+                napi_value exception;
+                napi_get_and_clear_last_exception(env, &exception);
+            }
+
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Unable to allocate %zu bytes for a %dx%d region", bytes, region.canvas_width, region.canvas_height);
+            napi_throw_range_error(env, NULL, msg);
             goto cleanup;
         }
-    }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+        if(!write_page_region(book, pageIndex, &region, data, NULL, NULL)) {
+            napi_throw_error(env, NULL, plutobook_get_error_message());
+            goto cleanup;
+        }
 
-    const char* mime_type = mimeType ? mimeType : "";
-    const char* text_encoding = textEncoding ? textEncoding : "";
-    const char* user_style = userStyle ? userStyle : "";
-    const char* user_script = userScript ? userScript : "";
-    const char* base_url = baseUrl ? baseUrl : "";
+        result = buffer;
+    } else {
+        if(!write_page_region(book, pageIndex, &region, NULL, stream_write_func, &stream)) {
+            napi_throw_error(env, NULL, plutobook_get_error_message());
+            goto cleanup;
+        }
 
-    if(!plutobook_load_data(book, buffer, length, mime_type, text_encoding, user_style, user_script, base_url)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
-        thisArg = NULL;
+        bytes = stream.size;
+        napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
     }
 
 cleanup:
-    free(mimeType);
-    free(textEncoding);
-    free(userStyle);
-    free(userScript);
-    free(baseUrl);
-    return thisArg;
+    metrics_record_render(METRIC_OUTPUT_REGION, start_time, bytes, result != NULL);
+    memory_stream_destroy(&stream);
+    return result;
 }
 
-static napi_value Book_LoadImage(napi_env env, napi_callback_info info)
+static napi_value Book_RenderRegionInto(napi_env env, napi_callback_info info)
 {
-    size_t argc = 2;
-    napi_value argv[2];
+    size_t argc = 3;
+    napi_value argv[3];
     napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+    if(!get_callback_info(env, info, &argc, argv, &thisArg, 2, 1)) {
         return NULL;
     }
 
-    void* buffer;
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
+        return NULL;
+    }
+
+    plutobook_t* book = self->book;
+
+    void* data;
     size_t length;
-    if(!get_buffer_argument(env, argv, 0, &buffer, &length)) {
+    if(!get_target_argument(env, argv, 0, &data, &length)) {
         return NULL;
     }
 
-    char* mimeType = NULL;
-    char* textEncoding = NULL;
-    char* userStyle = NULL;
-    char* userScript = NULL;
-    char* baseUrl = NULL;
+    int64_t pageIndex;
+    region_options_t region;
+    if(!get_region_arguments(env, self, argv, argc, 1, &pageIndex, &region)) {
+        return NULL;
+    }
 
-    if(argc == 2) {
-        option_t options[] = {
-            {"mimeType", string_option_func, &mimeType},
-            {"textEncoding", string_option_func, &textEncoding},
-            {"userStyle", string_option_func, &userStyle},
-            {"userScript", string_option_func, &userScript},
-            {"baseUrl", string_option_func, &baseUrl},
-            {NULL}
-        };
+    uint64_t start_time = uv_hrtime();
+    napi_value result = NULL;
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            thisArg = NULL;
+    target_stream_t stream;
+    target_stream_init(&stream, data, length);
+
+    if(region.format == REGION_FORMAT_RAW) {
+        stream.size = (size_t)region.canvas_width * 4 * region.canvas_height;
+        if(!check_target_size(env, stream.size, length)) {
+            goto cleanup;
+        }
+
+        if((uintptr_t)data % 4 != 0) {
+            napi_throw_range_error(env, NULL, "Target must be 4-byte aligned for raw pixel output");
+            goto cleanup;
+        }
+
+        if(!write_page_region(book, pageIndex, &region, data, NULL, NULL)) {
+            napi_throw_error(env, NULL, plutobook_get_error_message());
+            goto cleanup;
+        }
+    } else {
+        if(!write_page_region(book, pageIndex, &region, NULL, target_stream_write_func, &stream)) {
+            napi_throw_error(env, NULL, plutobook_get_error_message());
+            goto cleanup;
+        }
+
+        if(!check_target_size(env, stream.size, length)) {
             goto cleanup;
         }
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    napi_create_int64(env, stream.size, &result);
+cleanup:
+    metrics_record_render(METRIC_OUTPUT_REGION, start_time, stream.size, result != NULL);
+    return result;
+}
+
+#define SNAPSHOT_MAGIC "PLUTOSNP"
+#define SNAPSHOT_MAGIC_SIZE 8
+#define SNAPSHOT_VERSION 2
+
+static const plutobook_pdf_metadata_t snapshot_metadata[] = {
+    PLUTOBOOK_PDF_METADATA_TITLE,
+    PLUTOBOOK_PDF_METADATA_AUTHOR,
+    PLUTOBOOK_PDF_METADATA_SUBJECT,
+    PLUTOBOOK_PDF_METADATA_KEYWORDS,
+    PLUTOBOOK_PDF_METADATA_CREATOR,
+    PLUTOBOOK_PDF_METADATA_CREATION_DATE,
+    PLUTOBOOK_PDF_METADATA_MODIFICATION_DATE
+};
+
+#define SNAPSHOT_METADATA_COUNT (sizeof(snapshot_metadata) / sizeof(plutobook_pdf_metadata_t))
+
+static bool snapshot_write_u32(memory_stream_t* stream, uint32_t value)
+{
+    unsigned char data[4];
+    store_be32(data, value);
+    return stream_write_func(stream, (const char*)data, 4) == PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+static bool snapshot_write_u64(memory_stream_t* stream, uint64_t value)
+{
+    return snapshot_write_u32(stream, (uint32_t)(value >> 32)) && snapshot_write_u32(stream, (uint32_t)value);
+}
+
+static bool snapshot_write_float(memory_stream_t* stream, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return snapshot_write_u32(stream, bits);
+}
+
+static bool snapshot_write_double(memory_stream_t* stream, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return snapshot_write_u64(stream, bits);
+}
+
+static bool snapshot_write_blob(memory_stream_t* stream, const char* data, size_t length)
+{
+    if(length >= UINT32_MAX || !snapshot_write_u32(stream, (uint32_t)length))
+        return false;
+    if(length > 0 && stream_write_func(stream, data, (unsigned int)length) != PLUTOBOOK_STREAM_STATUS_SUCCESS)
+        return false;
+    return stream_write_func(stream, "", 1) == PLUTOBOOK_STREAM_STATUS_SUCCESS;
+}
+
+static bool snapshot_write_string(memory_stream_t* stream, const char* value)
+{
+    if(value == NULL)
+        value = "";
+    return snapshot_write_blob(stream, value, strlen(value));
+}
+
+static bool write_book_snapshot(const book_t* self, memory_stream_t* stream)
+{
+    const plutobook_t* book = self->book;
+    plutobook_page_size_t size = plutobook_get_page_size(book);
+    plutobook_page_margins_t margins = plutobook_get_page_margins(book);
+    if(stream_write_func(stream, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != PLUTOBOOK_STREAM_STATUS_SUCCESS
+        || !snapshot_write_u32(stream, SNAPSHOT_VERSION)
+        || !snapshot_write_float(stream, size.width)
+        || !snapshot_write_float(stream, size.height)
+        || !snapshot_write_float(stream, margins.top)
+        || !snapshot_write_float(stream, margins.right)
+        || !snapshot_write_float(stream, margins.bottom)
+        || !snapshot_write_float(stream, margins.left)
+        || !snapshot_write_u32(stream, plutobook_get_media_type(book))
+        || !snapshot_write_double(stream, self->max_image_dpi)) {
+        return false;
+    }
+
+    for(size_t i = 0; i < BOOK_LIMIT_COUNT; ++i) {
+        if(!snapshot_write_u64(stream, (uint64_t)self->limits[i])) {
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < SNAPSHOT_METADATA_COUNT; ++i) {
+        if(!snapshot_write_string(stream, plutobook_get_metadata(book, snapshot_metadata[i]))) {
+            return false;
+        }
+    }
 
-    const char* mime_type = mimeType ? mimeType : "";
-    const char* text_encoding = textEncoding ? textEncoding : "";
-    const char* user_style = userStyle ? userStyle : "";
-    const char* user_script = userScript ? userScript : "";
-    const char* base_url = baseUrl ? baseUrl : "";
+    const book_source_t* source = &self->source;
+    if(!snapshot_write_u32(stream, source->kind)
+        || !snapshot_write_blob(stream, source->content, source->length)
+        || !snapshot_write_string(stream, source->mime_type)
+        || !snapshot_write_string(stream, source->text_encoding)
+        || !snapshot_write_string(stream, source->user_style)
+        || !snapshot_write_string(stream, source->user_script)
+        || !snapshot_write_string(stream, source->base_url)
+        || !snapshot_write_u32(stream, (uint32_t)self->recorded.count)) {
+        return false;
+    }
 
-    if(!plutobook_load_image(book, buffer, length, mime_type, text_encoding, user_style, user_script, base_url)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
-        thisArg = NULL;
+    for(size_t i = 0; i < self->recorded.bucket_count; ++i) {
+        for(const resource_entry_t* entry = self->recorded.buckets[i]; entry; entry = entry->next) {
+            if(!snapshot_write_string(stream, entry->url)
+                || !snapshot_write_string(stream, plutobook_resource_data_get_mime_type(entry->data))
+                || !snapshot_write_string(stream, plutobook_resource_data_get_text_encoding(entry->data))
+                || !snapshot_write_blob(stream, plutobook_resource_data_get_content(entry->data), plutobook_resource_data_get_content_length(entry->data))) {
+                return false;
+            }
+        }
     }
 
-cleanup:
-    free(mimeType);
-    free(textEncoding);
-    free(userStyle);
-    free(userScript);
-    free(baseUrl);
-    return thisArg;
+    return true;
 }
 
-static napi_value Book_WriteToPdf(napi_env env, napi_callback_info info)
+static napi_value Book_SaveSnapshot(napi_env env, napi_callback_info info)
 {
-    size_t argc = 2;
-    napi_value argv[2];
     napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
+    if(!get_callback_info(env, info, NULL, NULL, &thisArg, 0, 0)) {
         return NULL;
     }
 
-    char* path = get_string_argument(env, argv, 0);
-    if(path == NULL) {
+    book_t* self = get_book(env, thisArg);
+    if(self == NULL) {
         return NULL;
     }
 
-    napi_value result = NULL;
-
-    int64_t pageStart = PLUTOBOOK_MIN_PAGE_COUNT;
-    int64_t pageEnd = PLUTOBOOK_MAX_PAGE_COUNT;
-    int64_t pageStep = 1;
-
-    if(argc == 2) {
-        option_t options[] = {
-            {"pageStart", integer_option_func, &pageStart},
-            {"pageEnd", integer_option_func, &pageEnd},
-            {"pageStep", integer_option_func, &pageStep},
-            {NULL}
-        };
+    if(!self->record) {
+        napi_throw_error(env, NULL, "Book was not created with `recordSnapshot` enabled");
+        return NULL;
+    }
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            goto cleanup;
-        }
+    if(self->source.kind == BOOK_SOURCE_NONE) {
+        napi_throw_error(env, NULL, "Book has no loaded content to snapshot");
+        return NULL;
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    napi_value result = NULL;
 
-    if(!plutobook_write_to_pdf_range(book, path, pageStart, pageEnd, pageStep)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
+    memory_stream_t stream;
+    memory_stream_init(&stream);
+    if(!write_book_snapshot(self, &stream)) {
+        napi_throw_error(env, NULL, "Unable to write snapshot");
         goto cleanup;
     }
 
-    napi_get_undefined(env, &result);
+    napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
 cleanup:
-    free(path);
+    memory_stream_destroy(&stream);
     return result;
 }
 
 typedef struct {
-    char* data;
+    const unsigned char* data;
     size_t size;
-    size_t capacity;
-} memory_stream_t;
+    size_t offset;
+} snapshot_reader_t;
 
-static void memory_stream_init(memory_stream_t* stream)
+static bool snapshot_read_u32(snapshot_reader_t* reader, uint32_t* value)
 {
-    stream->data = NULL;
-    stream->size = 0;
-    stream->capacity = 0;
+    if(reader->size - reader->offset < 4)
+        return false;
+    const unsigned char* data = reader->data + reader->offset;
+    *value = (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+    reader->offset += 4;
+    return true;
 }
 
-static void memory_stream_destroy(memory_stream_t* stream)
+static bool snapshot_read_u64(snapshot_reader_t* reader, uint64_t* value)
 {
-    free(stream->data);
+    uint32_t high, low;
+    if(!snapshot_read_u32(reader, &high) || !snapshot_read_u32(reader, &low))
+        return false;
+    *value = (uint64_t)high << 32 | low;
+    return true;
 }
 
-static plutobook_stream_status_t stream_write_func(void* closure, const char* data, unsigned int length)
+static bool snapshot_read_float(snapshot_reader_t* reader, float* value)
 {
-    memory_stream_t* stream = closure;
+    uint32_t bits;
+    if(!snapshot_read_u32(reader, &bits))
+        return false;
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
 
-    size_t required_capacity = stream->size + length;
-    if(required_capacity > stream->capacity) {
-        size_t new_capacity = stream->capacity == 0 ? 128 : stream->capacity;
-        while(new_capacity < required_capacity) {
-            new_capacity *= 2;
-        }
+static bool snapshot_read_double(snapshot_reader_t* reader, double* value)
+{
+    uint64_t bits;
+    if(!snapshot_read_u64(reader, &bits))
+        return false;
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
 
-        char* new_data = realloc(stream->data, new_capacity);
-        if(new_data == NULL)
-            return PLUTOBOOK_STREAM_STATUS_WRITE_ERROR;
-        stream->data = new_data;
-        stream->capacity = new_capacity;
-    }
+static bool snapshot_read_blob(snapshot_reader_t* reader, const char** data, size_t* length)
+{
+    uint32_t size;
+    if(!snapshot_read_u32(reader, &size))
+        return false;
+    if(reader->size - reader->offset <= size || reader->data[reader->offset + size] != '\0')
+        return false;
+    *data = (const char*)(reader->data + reader->offset);
+    *length = size;
+    reader->offset += size + 1;
+    return true;
+}
 
-    memcpy(stream->data + stream->size, data, length);
-    stream->size += length;
-    return PLUTOBOOK_STREAM_STATUS_SUCCESS;
+static bool snapshot_read_string(snapshot_reader_t* reader, const char** value)
+{
+    size_t length;
+    return snapshot_read_blob(reader, value, &length);
 }
 
-static napi_value Book_WriteToPdfBuffer(napi_env env, napi_callback_info info)
+typedef struct {
+    plutobook_page_size_t size;
+    plutobook_page_margins_t margins;
+    uint32_t media;
+    double max_image_dpi;
+    int64_t limits[BOOK_LIMIT_COUNT];
+    const char* metadata[SNAPSHOT_METADATA_COUNT];
+    uint32_t kind;
+    const char* content;
+    size_t length;
+    const char* mime_type;
+    const char* text_encoding;
+    const char* user_style;
+    const char* user_script;
+    const char* base_url;
+} snapshot_header_t;
+
+static bool read_snapshot_header(snapshot_reader_t* reader, snapshot_header_t* header)
 {
-    size_t argc = 1;
-    napi_value argv[1];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
-        return NULL;
+    uint32_t version;
+    if(reader->size < SNAPSHOT_MAGIC_SIZE || memcmp(reader->data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE))
+        return false;
+    reader->offset = SNAPSHOT_MAGIC_SIZE;
+    if(!snapshot_read_u32(reader, &version) || version != SNAPSHOT_VERSION)
+        return false;
+    if(!snapshot_read_float(reader, &header->size.width)
+        || !snapshot_read_float(reader, &header->size.height)
+        || !snapshot_read_float(reader, &header->margins.top)
+        || !snapshot_read_float(reader, &header->margins.right)
+        || !snapshot_read_float(reader, &header->margins.bottom)
+        || !snapshot_read_float(reader, &header->margins.left)
+        || !snapshot_read_u32(reader, &header->media)
+        || !snapshot_read_double(reader, &header->max_image_dpi)
+        || header->max_image_dpi < 0) {
+        return false;
     }
 
-    napi_value result = NULL;
-
-    memory_stream_t stream;
-    memory_stream_init(&stream);
-
-    int64_t pageStart = PLUTOBOOK_MIN_PAGE_COUNT;
-    int64_t pageEnd = PLUTOBOOK_MAX_PAGE_COUNT;
-    int64_t pageStep = 1;
-
-    if(argc == 1) {
-        option_t options[] = {
-            {"pageStart", integer_option_func, &pageStart},
-            {"pageEnd", integer_option_func, &pageEnd},
-            {"pageStep", integer_option_func, &pageStep},
-            {NULL}
-        };
-
-        if(!parse_options(env, argv, argc, 0, options)) {
-            goto cleanup;
-        }
+    for(size_t i = 0; i < BOOK_LIMIT_COUNT; ++i) {
+        uint64_t limit;
+        if(!snapshot_read_u64(reader, &limit) || limit > INT64_MAX)
+            return false;
+        header->limits[i] = (int64_t)limit;
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
-
-    if(!plutobook_write_to_pdf_stream_range(book, stream_write_func, &stream, pageStart, pageEnd, pageStep)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
-        goto cleanup;
+    for(size_t i = 0; i < SNAPSHOT_METADATA_COUNT; ++i) {
+        if(!snapshot_read_string(reader, &header->metadata[i])) {
+            return false;
+        }
     }
 
-    napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
-cleanup:
-    memory_stream_destroy(&stream);
-    return result;
+    return snapshot_read_u32(reader, &header->kind)
+        && header->kind > BOOK_SOURCE_NONE && header->kind <= BOOK_SOURCE_IMAGE
+        && header->media <= PLUTOBOOK_MEDIA_TYPE_SCREEN
+        && snapshot_read_blob(reader, &header->content, &header->length)
+        && snapshot_read_string(reader, &header->mime_type)
+        && snapshot_read_string(reader, &header->text_encoding)
+        && snapshot_read_string(reader, &header->user_style)
+        && snapshot_read_string(reader, &header->user_script)
+        && snapshot_read_string(reader, &header->base_url);
 }
 
-static napi_value Book_WriteToPng(napi_env env, napi_callback_info info)
+static bool read_snapshot_resources(snapshot_reader_t* reader, resource_store_t* store, bool copy)
 {
-    size_t argc = 2;
-    napi_value argv[2];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 1, 1)) {
-        return NULL;
-    }
-
-    char* path = get_string_argument(env, argv, 0);
-    if(path == NULL) {
-        return NULL;
-    }
-
-    napi_value result = NULL;
-
-    int64_t width = -1;
-    int64_t height = -1;
-
-    if(argc == 2) {
-        option_t options[] = {
-            {"width", integer_option_func, &width},
-            {"height", integer_option_func, &height},
-            {NULL}
-        };
+    uint32_t count;
+    if(!snapshot_read_u32(reader, &count))
+        return false;
+    for(uint32_t i = 0; i < count; ++i) {
+        const char* url;
+        const char* mime_type;
+        const char* text_encoding;
+        const char* content;
+        size_t length;
+        if(!snapshot_read_string(reader, &url)
+            || !snapshot_read_string(reader, &mime_type)
+            || !snapshot_read_string(reader, &text_encoding)
+            || !snapshot_read_blob(reader, &content, &length)) {
+            return false;
+        }
 
-        if(!parse_options(env, argv, argc, 1, options)) {
-            goto cleanup;
+        plutobook_resource_data_t* resource;
+        if(copy) {
+            resource = plutobook_resource_data_create(content, length, mime_type, text_encoding);
+            resource_store_account(store, length);
+        } else {
+            resource = plutobook_resource_data_create_without_copy(content, length, mime_type, text_encoding, NULL, NULL);
         }
+
+        resource_table_insert(&store->table, url, resource);
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    return true;
+}
 
-    if(!plutobook_write_to_png(book, path, width, height)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
-        goto cleanup;
+static bool load_book_snapshot(book_t* self, const snapshot_header_t* header)
+{
+    plutobook_t* book = self->book;
+    switch(header->kind) {
+    case BOOK_SOURCE_URL:
+        return plutobook_load_url(book, header->content, header->user_style, header->user_script);
+    case BOOK_SOURCE_HTML:
+        return plutobook_load_html(book, header->content, (int)header->length, header->user_style, header->user_script, header->base_url);
+    case BOOK_SOURCE_XML:
+        return plutobook_load_xml(book, header->content, (int)header->length, header->user_style, header->user_script, header->base_url);
+    case BOOK_SOURCE_DATA:
+        return plutobook_load_data(book, header->content, header->length, header->mime_type, header->text_encoding, header->user_style, header->user_script, header->base_url);
+    default:
+        return plutobook_load_image(book, header->content, header->length, header->mime_type, header->text_encoding, header->user_style, header->user_script, header->base_url);
     }
-
-    napi_get_undefined(env, &result);
-cleanup:
-    free(path);
-    return result;
 }
 
-static napi_value Book_WriteToPngBuffer(napi_env env, napi_callback_info info)
+static napi_value LoadSnapshot(napi_env env, napi_callback_info info)
 {
     size_t argc = 1;
     napi_value argv[1];
-    napi_value thisArg;
-    if(!get_callback_info(env, info, &argc, argv, &thisArg, 0, 1)) {
+    if(!get_callback_info(env, info, &argc, argv, NULL, 1, 1)) {
         return NULL;
     }
 
     napi_value result = NULL;
 
-    memory_stream_t stream;
-    memory_stream_init(&stream);
-
-    int64_t width = -1;
-    int64_t height = -1;
+    resource_store_t* store = resource_store_create();
 
-    if(argc == 1) {
-        option_t options[] = {
-            {"width", integer_option_func, &width},
-            {"height", integer_option_func, &height},
-            {NULL}
-        };
+    snapshot_reader_t reader = {NULL, 0, 0};
+    bool copy = true;
 
-        if(!parse_options(env, argv, argc, 0, options)) {
+    napi_valuetype type;
+    napi_typeof(env, argv[0], &type);
+    if(type == napi_string) {
+        char* path;
+        get_string_value(env, argv[0], &path);
+        if(!resource_store_map_file(store, path)) {
+            char msg[512];
+            snprintf(msg, sizeof(msg), "Could not open snapshot \"%s\": %s", path, strerror(errno));
+            napi_throw_error(env, NULL, msg);
+            free(path);
             goto cleanup;
         }
+
+        free(path);
+        reader.data = (const unsigned char*)store->mapping;
+        reader.size = store->mapping_size;
+        copy = false;
+    } else {
+        void* buffer;
+        if(!get_buffer_argument(env, argv, 0, &buffer, &reader.size))
+            goto cleanup;
+        reader.data = buffer;
     }
 
-    plutobook_t* book;
-    napi_unwrap(env, thisArg, (void**)&book);
+    snapshot_header_t header;
+    if(!read_snapshot_header(&reader, &header) || !read_snapshot_resources(&reader, store, copy)) {
+        napi_throw_error(env, NULL, "Invalid or unsupported snapshot data");
+        goto cleanup;
+    }
 
-    if(!plutobook_write_to_png_stream(book, stream_write_func, &stream, width, height)) {
-        napi_throw_error(env, NULL, plutobook_get_error_message());
+    book_options_t options;
+    book_options_init(&options);
+    options.size = header.size;
+    options.margins = header.margins;
+    options.media = header.media;
+    options.resources = resource_store_reference(store);
+    options.offline = true;
+    memcpy(options.limits, header.limits, sizeof(options.limits));
+    options.maxImageDpi = header.max_image_dpi;
+    options.recordSnapshot = true;
+
+    book_restore_t restore;
+    restore.book = plutobook_create(header.size, header.margins, header.media);
+    restore.options = &options;
+    for(size_t i = 0; i < SNAPSHOT_METADATA_COUNT; ++i) {
+        if(header.metadata[i][0]) {
+            plutobook_set_metadata(restore.book, snapshot_metadata[i], header.metadata[i]);
+        }
+    }
+
+    napi_value BookClass, external, instance;
+    napi_get_reference_value(env, get_instance_data(env)->BookClass_Ref, &BookClass);
+    napi_create_external(env, &restore, NULL, NULL, &external);
+    napi_status status = napi_new_instance(env, BookClass, 1, &external, &instance);
+    if(restore.book)
+        plutobook_destroy(restore.book);
+    book_options_destroy(&options);
+    if(status != napi_ok)
         goto cleanup;
+    book_t* self;
+    napi_unwrap(env, instance, (void**)&self);
+
+    book_begin_load(self);
+    book_record_source(self, header.kind, header.content, header.length, header.mime_type, header.text_encoding, header.user_style, header.user_script, header.base_url);
+    if(book_end_load(env, self, load_book_snapshot(self, &header))) {
+        result = instance;
     }
 
-    napi_create_buffer_copy(env, stream.size, stream.data, NULL, &result);
 cleanup:
-    memory_stream_destroy(&stream);
+    resource_store_release(store);
     return result;
 }
 
-static void BookClass_Init(napi_env env, napi_value exports)
+static void BookClass_Init(napi_env env, napi_value exports, napi_ref* class_ref)
 {
     const napi_property_descriptor properties[] = {
         {"pageCount", NULL, NULL, Book_PageCount, NULL, NULL, napi_default, NULL },
@@ -1037,18 +6145,215 @@ static void BookClass_Init(napi_env env, napi_value exports)
         {"loadImage", NULL, Book_LoadImage, NULL, NULL, NULL, napi_default, NULL },
         {"writeToPdf", NULL, Book_WriteToPdf, NULL, NULL, NULL, napi_default, NULL },
         {"writeToPdfBuffer", NULL, Book_WriteToPdfBuffer, NULL, NULL, NULL, napi_default, NULL },
+        {"writeToPdfInto", NULL, Book_WriteToPdfInto, NULL, NULL, NULL, napi_default, NULL },
+        {"writeToPdfAsync", NULL, Book_WriteToPdfAsync, NULL, NULL, NULL, napi_default, NULL },
+        {"splitToPdf", NULL, Book_SplitToPdf, NULL, NULL, NULL, napi_default, NULL },
         {"writeToPng", NULL, Book_WriteToPng, NULL, NULL, NULL, napi_default, NULL },
         {"writeToPngBuffer", NULL, Book_WriteToPngBuffer, NULL, NULL, NULL, napi_default, NULL },
+        {"writeToPngInto", NULL, Book_WriteToPngInto, NULL, NULL, NULL, napi_default, NULL },
+        {"renderRegion", NULL, Book_RenderRegion, NULL, NULL, NULL, napi_default, NULL },
+        {"renderRegionInto", NULL, Book_RenderRegionInto, NULL, NULL, NULL, napi_default, NULL },
+        {"saveSnapshot", NULL, Book_SaveSnapshot, NULL, NULL, NULL, napi_default, NULL },
     };
 
     size_t property_count = sizeof(properties) / sizeof(napi_property_descriptor);
 
     napi_value BookClass;
     napi_define_class(env, "Book", NAPI_AUTO_LENGTH, BookClass_Constructor, NULL, property_count, properties, &BookClass);
-    napi_create_reference(env, BookClass, 1, &BookClass_Ref);
+    napi_create_reference(env, BookClass, 1, class_ref);
     napi_set_named_property(env, exports, "Book", BookClass);
 }
 
+#define WARMUP_SAMPLE_TEXT "The quick brown fox jumps over the lazy dog. 0123456789 <b>Bold</b> <i>Italic</i>"
+
+typedef struct {
+    napi_async_work work;
+    napi_deferred deferred;
+    memory_stream_t html;
+    bool success;
+    char* error_message;
+    double load_time;
+    double render_time;
+    double elapsed;
+} warmup_t;
+
+static void append_html(memory_stream_t* stream, const char* data, size_t length)
+{
+    stream_write_func(stream, data, length);
+}
+
+static bool append_warmup_strings(napi_env env, napi_value value, const char* name, memory_stream_t* html, bool locale)
+{
+    bool is_array;
+    napi_is_array(env, value, &is_array);
+    if(!is_array) {
+        napi_valuetype type;
+        napi_typeof(env, value, &type);
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Property `%s` must be array, not %s", name, type_name(type));
+        napi_throw_type_error(env, NULL, msg);
+        return false;
+    }
+
+    uint32_t length;
+    napi_get_array_length(env, value, &length);
+    for(uint32_t i = 0; i < length; ++i) {
+        napi_value element;
+        napi_get_element(env, value, i, &element);
+
+        char* string;
+        if(!get_string_value(env, element, &string)) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Property `%s` must contain only strings", name);
+            napi_throw_type_error(env, NULL, msg);
+            return false;
+        }
+
+        if(locale) {
+            append_html(html, "<p lang=\"", 9);
+            for(const char* it = string; *it; ++it) {
+                if(isalnum((unsigned char)*it) || *it == '-' || *it == '_') {
+                    append_html(html, it, 1);
+                }
+            }
+
+            append_html(html, "\" style=\"hyphens:auto\">", 23);
+        } else {
+            append_html(html, "<p style=\"font-family:'", 23);
+            for(const char* it = string; *it; ++it) {
+                if(*it == '\'' || *it == '\\') {
+                    append_html(html, "\\", 1);
+                    append_html(html, it, 1);
+                } else if(*it == '"') {
+                    append_html(html, "&quot;", 6);
+                } else if(*it == '<') {
+                    append_html(html, "&lt;", 4);
+                } else if(*it == '&') {
+                    append_html(html, "&amp;", 5);
+                } else {
+                    append_html(html, it, 1);
+                }
+            }
+
+            append_html(html, "'\">", 3);
+        }
+
+        append_html(html, WARMUP_SAMPLE_TEXT "</p>", sizeof(WARMUP_SAMPLE_TEXT "</p>") - 1);
+        free(string);
+    }
+
+    return true;
+}
+
+static void warmup_execute(napi_env env, void* data)
+{
+    warmup_t* warmup = data;
+    uint64_t start_time = uv_hrtime();
+
+    book_options_t options;
+    book_options_init(&options);
+
+    plutobook_t* book = plutobook_create(options.size, options.margins, options.media);
+    warmup->success = plutobook_load_html(book, warmup->html.data, warmup->html.size, "", "", "");
+
+    uint64_t load_time = uv_hrtime();
+    if(warmup->success) {
+        plutobook_canvas_t* canvas = render_document_image(book, 0, 0, 1);
+        if(canvas) {
+            plutobook_canvas_destroy(canvas);
+        } else {
+            warmup->success = false;
+        }
+    }
+
+    if(!warmup->success) {
+        const char* message = plutobook_get_error_message();
+        warmup->error_message = copy_string(message, strlen(message));
+    }
+
+    plutobook_destroy(book);
+
+    uint64_t end_time = uv_hrtime();
+    warmup->load_time = (load_time - start_time) / 1e6;
+    warmup->render_time = (end_time - load_time) / 1e6;
+    warmup->elapsed = (end_time - start_time) / 1e6;
+}
+
+static void warmup_complete(napi_env env, napi_status status, void* data)
+{
+    warmup_t* warmup = data;
+    if(warmup->success) {
+        napi_value result, value;
+        napi_create_object(env, &result);
+        napi_create_double(env, warmup->load_time, &value);
+        napi_set_named_property(env, result, "load", value);
+        napi_create_double(env, warmup->render_time, &value);
+        napi_set_named_property(env, result, "render", value);
+        napi_create_double(env, warmup->elapsed, &value);
+        napi_set_named_property(env, result, "elapsed", value);
+        napi_resolve_deferred(env, warmup->deferred, result);
+    } else {
+        napi_value message, error;
+        napi_create_string_utf8(env, warmup->error_message ? warmup->error_message : strerror(ENOMEM), NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, NULL, message, &error);
+        napi_reject_deferred(env, warmup->deferred, error);
+    }
+
+    napi_delete_async_work(env, warmup->work);
+    memory_stream_destroy(&warmup->html);
+    free(warmup->error_message);
+    free(warmup);
+}
+
+static napi_value Warmup(napi_env env, napi_callback_info info)
+{
+    size_t argc = 1;
+    napi_value argv[1];
+    if(!get_callback_info(env, info, &argc, argv, NULL, 0, 1)) {
+        return NULL;
+    }
+
+    memory_stream_t html;
+    memory_stream_init(&html);
+    append_html(&html, "<html><body><p>" WARMUP_SAMPLE_TEXT "</p>", sizeof("<html><body><p>" WARMUP_SAMPLE_TEXT "</p>") - 1);
+    if(argc == 1) {
+        napi_valuetype type;
+        napi_typeof(env, argv[0], &type);
+        if(type != napi_object) {
+            throw_argument_type_error(env, argv, 0, napi_object);
+            memory_stream_destroy(&html);
+            return NULL;
+        }
+
+        static const char* names[] = {"fonts", "locales"};
+        for(int i = 0; i < 2; ++i) {
+            bool has_property;
+            napi_has_named_property(env, argv[0], names[i], &has_property);
+            if(has_property) {
+                napi_value property;
+                napi_get_named_property(env, argv[0], names[i], &property);
+                if(!append_warmup_strings(env, property, names[i], &html, i == 1)) {
+                    memory_stream_destroy(&html);
+                    return NULL;
+                }
+            }
+        }
+    }
+
+    append_html(&html, "</body></html>", 14);
+
+    warmup_t* warmup = calloc(1, sizeof(warmup_t));
+    warmup->html = html;
+
+    napi_value promise, resource_name;
+    napi_create_promise(env, &warmup->deferred, &promise);
+    napi_create_string_utf8(env, "plutoprint:warmup", NAPI_AUTO_LENGTH, &resource_name);
+    napi_create_async_work(env, NULL, resource_name, warmup_execute, warmup_complete, warmup, &warmup->work);
+    napi_queue_async_work(env, warmup->work);
+    return promise;
+}
+
 #define EXPORT_STRING(name, string) do { \
     napi_value result; \
     napi_create_string_utf8(env, string, NAPI_AUTO_LENGTH, &result); \
@@ -1075,9 +6380,25 @@ static void BookClass_Init(napi_env env, napi_value exports)
 
 napi_value Init(napi_env env, napi_value exports)
 {
-    BookClass_Init(env, exports);
+    instance_data_t* instance_data = calloc(1, sizeof(instance_data_t));
+    napi_set_instance_data(env, instance_data, InstanceData_Finalize, NULL);
+
+    BookClass_Init(env, exports, &instance_data->BookClass_Ref);
+
+    OptionsClass_Init(env, "BookOptions", &instance_data->BookOptionsClass_Ref);
+    OptionsClass_Init(env, "PdfOptions", &instance_data->PdfOptionsClass_Ref);
+    OptionsClass_Init(env, "PngOptions", &instance_data->PngOptionsClass_Ref);
 
     EXPORT_FUNCTION("createBook", CreateBook);
+    EXPORT_FUNCTION("createBookOptions", CreateBookOptions);
+    EXPORT_FUNCTION("createPdfOptions", CreatePdfOptions);
+    EXPORT_FUNCTION("createPngOptions", CreatePngOptions);
+    EXPORT_FUNCTION("warmup", Warmup);
+    EXPORT_FUNCTION("setResourceCacheSize", SetResourceCacheSize);
+    EXPORT_FUNCTION("getResourceCacheStats", GetResourceCacheStats);
+    EXPORT_FUNCTION("clearResourceCache", ClearResourceCache);
+    EXPORT_FUNCTION("metrics", Metrics);
+    EXPORT_FUNCTION("loadSnapshot", LoadSnapshot);
 
     EXPORT_STRING("plutobookVersion", plutobook_version_string());
     EXPORT_STRING("plutobookBuildInfo", plutobook_build_info());
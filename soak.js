@@ -0,0 +1,448 @@
+#!/usr/bin/env node
+'use strict';
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { parseArgs } = require('util');
+const { pathToFileURL } = require('url');
+const { Worker, isMainThread, parentPort, workerData, threadId } = require('worker_threads');
+
+const USAGE = `Usage: node --expose-gc soak.js [options]
+
+Runs create/load/write/finalize cycles against offline fixtures on a pool
+of worker threads, covering every Book method and its error paths. RSS,
+native bytes held by the binding, live books, open file descriptors and
+active handles are sampled over time, and the run fails if any of them
+grows past its threshold after the warm-up.
+
+  -n, --cycles <n>              Total cycles across all workers (default: 1000000)
+  -j, --jobs <n>                Number of worker threads (default: CPU count)
+      --warmup <n>              Cycles per worker before the baseline (default: 200)
+      --interval <ms>           Sampling interval (default: 5000)
+      --max-rss-growth <MiB>    Allowed RSS growth (default: 64)
+      --max-native-growth <KiB> Allowed growth of native bytes (default: 64)
+      --max-handle-growth <n>   Allowed growth of descriptors and handles (default: 8)
+  -h, --help                    Show this help`;
+
+const OPTIONS = {
+    cycles: { type: 'string', short: 'n', default: '1000000' },
+    jobs: { type: 'string', short: 'j' },
+    warmup: { type: 'string', default: '200' },
+    interval: { type: 'string', default: '5000' },
+    'max-rss-growth': { type: 'string', default: '64' },
+    'max-native-growth': { type: 'string', default: '64' },
+    'max-handle-growth': { type: 'string', default: '8' },
+    help: { type: 'boolean', short: 'h' }
+};
+
+const BASE_URL = 'https://fixtures.invalid/';
+
+function fail(message) {
+    console.error(`soak: ${message}`);
+    process.exit(2);
+}
+
+function parseCount(values, name) {
+    const number = Number(values[name]);
+    if(!Number.isInteger(number) || number < 0)
+        fail(`--${name} must be a non-negative integer, got "${values[name]}"`);
+    return number;
+}
+
+function collectGarbage() {
+    if(global.gc) {
+        global.gc();
+    }
+}
+
+function countDescriptors() {
+    try {
+        return fs.readdirSync('/proc/self/fd').length;
+    } catch {
+        return 0;
+    }
+}
+
+function countHandles() {
+    return process.getActiveResourcesInfo ? process.getActiveResourcesInfo().length : 0;
+}
+
+function formatBytes(bytes) {
+    const units = ['B', 'KiB', 'MiB', 'GiB'];
+    let unit = 0;
+    while(Math.abs(bytes) >= 1024 && unit < units.length - 1) {
+        bytes /= 1024;
+        unit++;
+    }
+
+    return `${bytes.toFixed(unit === 0 ? 0 : 1)} ${units[unit]}`;
+}
+
+function createTar(entries) {
+    const blocks = [];
+    for(const [name, content] of Object.entries(entries)) {
+        const header = Buffer.alloc(512);
+        header.write(name, 0, 100);
+        header.write('0000644\0', 100);
+        header.write('0000000\0', 108);
+        header.write('0000000\0', 116);
+        header.write(content.length.toString(8).padStart(11, '0') + '\0', 124);
+        header.write('00000000000\0', 136);
+        header.write('        ', 148);
+        header.write('0', 156);
+        header.write('ustar\0' + '00', 257);
+        let checksum = 0;
+        for(const byte of header)
+            checksum += byte;
+        header.write(checksum.toString(8).padStart(6, '0') + '\0 ', 148);
+        blocks.push(header, content, Buffer.alloc((512 - content.length % 512) % 512));
+    }
+
+    blocks.push(Buffer.alloc(1024));
+    return Buffer.concat(blocks);
+}
+
+function fixtureResources(style, tile) {
+    return { [`${BASE_URL}style.css`]: style, [`${BASE_URL}tile.png`]: tile };
+}
+
+function createFixtures(plutoprint) {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-soak-'));
+    const tile = plutoprint.createBook({ width: '32px', height: '32px', margin: 0 })
+        .loadHtml('<div style="width:32px;height:32px;background:linear-gradient(#c33,#33c)"></div>')
+        .writeToPngBuffer();
+    const style = Buffer.from('body { font: 11pt serif } .tile { width: 64px; height: 64px; background: url(tile.png) }');
+    const paragraphs = Array.from({ length: 60 }, (_, i) => `<p${i % 20 === 0 ? ' style="break-before: page"' : ''}>Paragraph ${i}: The quick brown fox jumps over the lazy dog.</p>`).join('');
+    const html = `<html><head><link rel="stylesheet" href="style.css"></head><body><div class="tile"></div><img src="tile.png">${paragraphs}</body></html>`;
+
+    const files = {
+        'style.css': style,
+        'tile.png': tile,
+        'index.html': Buffer.from(html),
+        'image.svg': Buffer.from('<svg xmlns="http://www.w3.org/2000/svg" width="120" height="80"><rect width="120" height="80" fill="#3a7"/></svg>'),
+        'assets.tar': createTar({ 'fixtures.invalid/style.css': style, 'fixtures.invalid/tile.png': tile })
+    };
+
+    for(const [name, content] of Object.entries(files))
+        fs.writeFileSync(path.join(dir, name), content);
+    const book = plutoprint.createBook({ recordSnapshot: true, resources: fixtureResources(style, tile), offline: true });
+    book.loadHtml(html, { baseUrl: BASE_URL });
+    fs.writeFileSync(path.join(dir, 'book.snapshot'), book.saveSnapshot());
+    return dir;
+}
+
+function main() {
+    let parsed;
+    try {
+        parsed = parseArgs({ options: OPTIONS });
+    } catch(error) {
+        fail(error.message);
+    }
+
+    const { values } = parsed;
+    if(values.help) {
+        console.log(USAGE);
+        return;
+    }
+
+    const cycles = parseCount(values, 'cycles');
+    const warmup = parseCount(values, 'warmup');
+    const interval = parseCount(values, 'interval');
+    const maxRssGrowth = parseCount(values, 'max-rss-growth') * 1024 * 1024;
+    const maxNativeGrowth = parseCount(values, 'max-native-growth') * 1024;
+    const maxHandleGrowth = parseCount(values, 'max-handle-growth');
+    const jobs = values.jobs === undefined ? (os.availableParallelism ? os.availableParallelism() : os.cpus().length) : Number(values.jobs);
+    if(!Number.isInteger(jobs) || jobs < 1) {
+        fail(`--jobs must be a positive integer, got "${values.jobs}"`);
+    }
+
+    if(!global.gc)
+        console.warn('soak: run with --expose-gc for stable measurements');
+    const plutoprint = require('./index');
+    const dir = createFixtures(plutoprint);
+
+    const perWorker = Math.ceil(cycles / jobs);
+    const progress = new Array(jobs).fill(0);
+    const workerHandles = new Array(jobs).fill(0);
+    const errors = [];
+    const start = process.hrtime.bigint();
+    let baseline = null;
+    let warmedUp = 0;
+    let peak = null;
+
+    const sample = () => {
+        collectGarbage();
+        const metrics = plutoprint.metrics();
+        return {
+            cycles: progress.reduce((a, b) => a + b, 0),
+            rss: process.memoryUsage.rss(),
+            nativeBytes: metrics.nativeBytes,
+            booksLive: metrics.booksLive,
+            descriptors: countDescriptors(),
+            handles: countHandles() + workerHandles.reduce((a, b) => a + b, 0)
+        };
+    };
+
+    const report = (current) => {
+        const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+        const growth = baseline ? ` (${current.rss >= baseline.rss ? '+' : ''}${formatBytes(current.rss - baseline.rss)})` : ' (warming up)';
+        console.log(`${seconds.toFixed(0)}s ${current.cycles} cycles (${(current.cycles / seconds || 0).toFixed(0)}/s)`
+            + ` rss ${formatBytes(current.rss)}${growth} native ${formatBytes(current.nativeBytes)}`
+            + ` books ${current.booksLive} fds ${current.descriptors} handles ${current.handles}`);
+    };
+
+    const timer = setInterval(() => {
+        const current = sample();
+        if(baseline) {
+            for(const key of Object.keys(current))
+                peak[key] = Math.max(peak[key], current[key]);
+        }
+
+        report(current);
+    }, interval);
+
+    const workers = [];
+    let done = 0;
+    const finish = () => {
+        clearInterval(timer);
+        const current = sample();
+        report(current);
+        for(const worker of workers)
+            worker.postMessage('exit');
+
+        const failures = errors.slice();
+        if(baseline) {
+            const checks = [
+                ['RSS', current.rss - baseline.rss, maxRssGrowth, formatBytes],
+                ['native bytes', current.nativeBytes - baseline.nativeBytes, maxNativeGrowth, formatBytes],
+                ['live books', current.booksLive - baseline.booksLive, jobs, String],
+                ['file descriptors', current.descriptors - baseline.descriptors, maxHandleGrowth, String],
+                ['active handles', current.handles - baseline.handles, maxHandleGrowth, String]
+            ];
+
+            for(const [name, growth, limit, format] of checks) {
+                if(growth > limit) {
+                    failures.push(`${name} grew by ${format(growth)}, limit is ${format(limit)}`);
+                }
+            }
+
+            console.log(`peak rss ${formatBytes(peak.rss)}, peak native ${formatBytes(peak.nativeBytes)}, peak books ${peak.booksLive}`);
+        }
+
+        for(const failure of failures)
+            console.error(`soak: ${failure}`);
+        console.log(failures.length === 0 ? 'soak: passed' : 'soak: FAILED');
+        process.exitCode = failures.length === 0 ? 0 : 1;
+    };
+
+    let running = jobs;
+    const exited = () => {
+        if(--running === 0) {
+            fs.rmSync(dir, { recursive: true, force: true });
+        }
+    };
+
+    for(let i = 0; i < jobs; ++i) {
+        const worker = new Worker(__filename, { workerData: { dir, cycles: perWorker, warmup } });
+        workers.push(worker);
+        worker.on('message', (message) => {
+            progress[i] = message.cycles;
+            workerHandles[i] = message.handles;
+            if(message.error)
+                errors.push(`worker ${i}: ${message.error}`);
+            if(message.warmedUp && ++warmedUp === jobs) {
+                baseline = sample();
+                peak = Object.assign({}, baseline);
+                report(baseline);
+            }
+
+            if(message.done && ++done === jobs) {
+                finish();
+            }
+        });
+
+        worker.on('error', (error) => {
+            errors.push(`worker ${i}: ${error.stack}`);
+            if(++done === jobs) {
+                finish();
+            }
+        });
+
+        worker.on('exit', exited);
+    }
+}
+
+function expectError(code, callback) {
+    try {
+        callback();
+    } catch(error) {
+        if(code && error.code !== code)
+            throw new Error(`expected ${code}, got ${error.code}: ${error.message}`);
+        return;
+    }
+
+    throw new Error(`expected ${code || 'an error'}`);
+}
+
+async function runCycle(plutoprint, fixtures, cycle) {
+    const { dir, files, resources, target, small } = fixtures;
+    const bookOptions = [
+        { resources, offline: true },
+        { resources: path.join(dir, 'assets.tar'), offline: true, maxImageDpi: 72 },
+        { resources, offline: true, recordSnapshot: true, size: 'letter', margin: '1in', title: 'Soak', creationDate: new Date() },
+        fixtures.bookOptions
+    ][cycle % 4];
+
+    let book = plutoprint.createBook(bookOptions);
+    switch(cycle % 7) {
+    case 0:
+        book.loadHtml(files['index.html'].toString(), { baseUrl: BASE_URL, userStyle: 'p { color: #333 }' });
+        break;
+    case 1:
+        book.loadXml(`<html xmlns="http://www.w3.org/1999/xhtml"><body><p>Cycle ${cycle}</p></body></html>`, {});
+        break;
+    case 2:
+        book.loadData(files['index.html'], { mimeType: 'text/html', textEncoding: 'utf-8', baseUrl: BASE_URL });
+        break;
+    case 3:
+        book.loadImage(files['image.svg'], { mimeType: 'image/svg+xml' });
+        break;
+    case 4:
+        book.loadUrl(pathToFileURL(path.join(dir, 'index.html')).href, { prefetch: cycle % 2 === 0, prefetchConcurrency: 2 });
+        break;
+    case 5:
+        book = plutoprint.loadSnapshot(path.join(dir, 'book.snapshot'));
+        break;
+    default:
+        book = plutoprint.loadSnapshot(fixtures.snapshot);
+        break;
+    }
+
+    if(book.pageCount < 1 || !(book.documentWidth > 0) || !(book.documentHeight >= 0) || !(book.viewportWidth > 0) || !(book.viewportHeight > 0))
+        throw new Error(`unexpected document metrics in cycle ${cycle}`);
+    const output = path.join(dir, `out-${threadId}`);
+    switch(cycle % 5) {
+    case 0:
+        book.writeToPdf(`${output}.pdf`, cycle % 2 ? fixtures.pdfOptions : { pageStart: 1, sync: 'none' });
+        book.writeToPng(`${output}.png`, cycle % 2 ? fixtures.pngOptions : { width: 64 });
+        break;
+    case 1:
+        book.writeToPdfBuffer({ pageStart: 1, pageEnd: 1 });
+        book.writeToPngBuffer({ width: 48, compressionLevel: cycle % 10, filter: 'adaptive', colorType: 'rgb' });
+        break;
+    case 2:
+        book.writeToPdfInto(target);
+        book.writeToPngInto(target, fixtures.pngOptions);
+        expectError('ERR_BUFFER_TOO_SMALL', () => book.writeToPdfInto(small));
+        break;
+    case 3: {
+        const pending = book.writeToPdfAsync({ onPage: () => {} });
+        expectError('ERR_PLUTOPRINT_BUSY', () => book.writeToPdfBuffer());
+        await pending;
+        await book.writeToPdfAsync(fixtures.pdfOptions).catch(() => {});
+        break;
+    }
+    default:
+        book.splitToPdf({ every: 1 });
+        if(cycle % 2 === 0)
+            book.splitToPdf({ ranges: [[1, 1]], path: `${output}-%d.pdf` });
+        break;
+    }
+
+    book.renderRegion(0, { width: 40, height: 30, scale: 2 });
+    book.renderRegion(0, { width: 40, height: 30, format: 'raw' });
+    book.renderRegionInto(target, 0, { width: 40, height: 30, format: cycle % 2 ? 'raw' : 'png' });
+    if(bookOptions.recordSnapshot)
+        fixtures.snapshot = book.saveSnapshot();
+
+    expectError(null, () => book.loadHtml(42));
+    expectError(null, () => book.loadHtml('<p>x</p>', { userStyle: 42 }));
+    expectError(null, () => book.loadData('not a buffer'));
+    expectError(null, () => book.loadUrl(BASE_URL + 'missing.html', {}));
+    expectError(null, () => book.writeToPdf(path.join(dir, 'missing', 'out.pdf')));
+    expectError(null, () => book.writeToPng(path.join(dir, 'missing', 'out.png'), { width: 16 }));
+    expectError(null, () => book.writeToPngBuffer({ compressionLevel: 42 }));
+    expectError(null, () => book.writeToPdfBuffer({ pageStart: 'first' }));
+    expectError(null, () => book.splitToPdf({ every: 1, ranges: [[1, 1]] }));
+    expectError(null, () => book.splitToPdf({ every: 1, path: 'no-placeholder.pdf' }));
+    expectError(null, () => book.renderRegion(1000));
+    expectError(null, () => book.renderRegion(0, { format: 'jpeg' }));
+    expectError('ERR_BUFFER_TOO_SMALL', () => book.renderRegionInto(small, 0, { format: 'raw' }));
+    expectError(null, () => book.writeToPdfInto('not a buffer'));
+    expectError(null, () => plutoprint.createBook({ size: 'unknown' }));
+    expectError(null, () => plutoprint.createBook({ resources: path.join(dir, 'missing.tar') }));
+    expectError(null, () => plutoprint.createBookOptions({ maxPages: -1 }));
+    expectError(null, () => plutoprint.loadSnapshot(files['style.css']));
+    expectError('ERR_PLUTOPRINT_LIMIT', () => plutoprint.createBook({ resources, offline: true, maxPages: 1 })
+        .loadHtml(files['index.html'].toString(), { baseUrl: BASE_URL }));
+    expectError('ERR_PLUTOPRINT_LIMIT', () => plutoprint.createBook({ resources, offline: true, maxResourceBytes: 1 })
+        .loadHtml(files['index.html'].toString(), { baseUrl: BASE_URL }));
+    expectError('ERR_PLUTOPRINT_LIMIT', () => plutoprint.createBook({ maxCanvasPixels: 1 }).loadHtml('<p>x</p>').writeToPngBuffer());
+    expectError(null, () => plutoprint.createBook({ recordSnapshot: false }).saveSnapshot());
+    if(cycle % 100 === 0) {
+        plutoprint.setResourceCacheSize(cycle % 200 ? 0 : 1024 * 1024);
+        plutoprint.getResourceCacheStats();
+        plutoprint.clearResourceCache();
+        plutoprint.metrics();
+    }
+}
+
+async function runWorker() {
+    const plutoprint = require('./index');
+    const { dir, cycles, warmup } = workerData;
+    const files = {};
+    for(const name of ['style.css', 'tile.png', 'index.html', 'image.svg'])
+        files[name] = fs.readFileSync(path.join(dir, name));
+    const resources = fixtureResources(files['style.css'], files['tile.png']);
+    const fixtures = {
+        dir,
+        files,
+        resources,
+        target: Buffer.allocUnsafe(4 * 1024 * 1024),
+        small: Buffer.alloc(16),
+        snapshot: fs.readFileSync(path.join(dir, 'book.snapshot')),
+        bookOptions: plutoprint.createBookOptions({ resources, offline: true, size: 'a5' }),
+        pdfOptions: plutoprint.createPdfOptions({ pageStart: 1, pageEnd: 2, bufferSize: 65536 }),
+        pngOptions: plutoprint.createPngOptions({ width: 80, scale: 1 })
+    };
+
+    const settle = async () => {
+        collectGarbage();
+        await new Promise((resolve) => setImmediate(resolve));
+    };
+
+    parentPort.once('message', () => process.exit(0));
+
+    let last = Date.now();
+    let completed = 0;
+    let error;
+    for(let cycle = 0; cycle < cycles; ++cycle) {
+        if(cycle === Math.min(warmup, cycles - 1)) {
+            await settle();
+            parentPort.postMessage({ cycles: cycle, handles: countHandles(), warmedUp: true });
+        }
+
+        try {
+            await runCycle(plutoprint, fixtures, cycle);
+        } catch(e) {
+            error = `cycle ${cycle}: ${e.stack}`;
+            break;
+        }
+
+        completed = cycle + 1;
+        if(Date.now() - last >= 1000) {
+            parentPort.postMessage({ cycles: completed, handles: countHandles() });
+            last = Date.now();
+        }
+    }
+
+    await settle();
+    parentPort.postMessage({ cycles: completed, handles: countHandles(), error, done: true });
+}
+
+if(isMainThread) {
+    main();
+} else {
+    runWorker();
+}
@@ -0,0 +1,73 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const { spawnSync } = require('node:child_process');
+
+const CLI = path.join(__dirname, '..', 'cli.js');
+
+function createInputs(t, count) {
+    const directory = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-'));
+    t.after(() => fs.rmSync(directory, { recursive: true, force: true }));
+    fs.mkdirSync(path.join(directory, 'docs'));
+    for(let i = 0; i < count; ++i)
+        fs.writeFileSync(path.join(directory, 'docs', `page-${i}.html`), '<div style="break-after:page">Page</div>'.repeat(i) + '<div>Page</div>');
+    return directory;
+}
+
+function run(directory, args, nodeArgs = []) {
+    return spawnSync(process.execPath, [...nodeArgs, CLI, ...args], { cwd: directory, encoding: 'utf8' });
+}
+
+function summary(result) {
+    return /^(\d+) converted, (\d+) skipped, (\d+) failed/m.exec(result.stdout).slice(1).map(Number);
+}
+
+test('cli converts inputs and skips unchanged ones', (t) => {
+    const directory = createInputs(t, 3);
+    const result = run(directory, ['-j', '2', '-o', 'out', 'docs']);
+    assert.strictEqual(result.status, 0, result.stderr);
+    assert.deepStrictEqual(summary(result), [3, 0, 0]);
+    assert.deepStrictEqual(fs.readdirSync(path.join(directory, 'out')).sort(), ['.plutoprint-manifest.json', 'page-0.pdf', 'page-1.pdf', 'page-2.pdf']);
+
+    const rerun = run(directory, ['-j', '2', '-o', 'out', 'docs']);
+    assert.strictEqual(rerun.status, 0, rerun.stderr);
+    assert.deepStrictEqual(summary(rerun), [0, 3, 0]);
+});
+
+test('cli rejects invalid book options before starting workers', (t) => {
+    const directory = createInputs(t, 3);
+    for(const args of [['--size', 'bogus'], ['--media', 'paper'], ['--width', '-'], ['--resources', 'missing.tar'], ['--user-style', 'missing.css']]) {
+        const result = run(directory, ['-j', '2', '-o', 'out', ...args, 'docs']);
+        assert.strictEqual(result.status, 2, args.join(' '));
+        assert.match(result.stderr, /^plutoprint: /);
+        assert.strictEqual(result.stdout, '');
+        assert.ok(!fs.existsSync(path.join(directory, 'out')), args.join(' '));
+    }
+});
+
+test('cli counts failed inputs', (t) => {
+    const directory = createInputs(t, 3);
+    const result = run(directory, ['-j', '2', '-o', 'out', '--max-pages', '2', 'docs']);
+    assert.strictEqual(result.status, 1);
+    assert.deepStrictEqual(summary(result), [2, 0, 1]);
+    assert.match(result.stderr, /page-2\.html: Limit `maxPages` of 2 exceeded/);
+});
+
+test('cli counts inputs left undispatched when every worker exits', (t) => {
+    const directory = createInputs(t, 4);
+    const preload = path.join(directory, 'crash.js');
+    fs.writeFileSync(preload, `
+        const { isMainThread } = require('node:worker_threads');
+        if(!isMainThread)
+            setImmediate(() => { throw new Error('worker crashed'); });
+    `);
+
+    const result = run(directory, ['-j', '2', '-o', 'out', 'docs'], ['--require', preload]);
+    assert.strictEqual(result.status, 1);
+    assert.deepStrictEqual(summary(result), [0, 0, 4]);
+    assert.match(result.stderr, /2 inputs not converted because all workers exited/);
+});
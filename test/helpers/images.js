@@ -0,0 +1,77 @@
+'use strict';
+
+const zlib = require('node:zlib');
+
+function crc32(data) {
+    let crc = ~0;
+    for(const byte of data) {
+        crc ^= byte;
+        for(let bit = 0; bit < 8; ++bit)
+            crc = (crc >>> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+
+    return ~crc >>> 0;
+}
+
+function pngChunk(type, data) {
+    const header = Buffer.alloc(8);
+    header.writeUInt32BE(data.length, 0);
+    header.write(type, 4, 'latin1');
+    const trailer = Buffer.alloc(4);
+    trailer.writeUInt32BE(crc32(Buffer.concat([header.subarray(4), data])), 0);
+    return Buffer.concat([header, data, trailer]);
+}
+
+// An RGB PNG filled with pseudo-random noise, so it does not compress.
+function createPng(width, height) {
+    const header = Buffer.alloc(13);
+    header.writeUInt32BE(width, 0);
+    header.writeUInt32BE(height, 4);
+    header[8] = 8;
+    header[9] = 2;
+
+    let seed = 1;
+    const stride = 1 + width * 3;
+    const pixels = Buffer.alloc(stride * height);
+    for(let y = 0; y < height; ++y) {
+        for(let x = 1; x < stride; ++x) {
+            seed = (Math.imul(seed, 1103515245) + 12345) >>> 0;
+            pixels[y * stride + x] = seed >>> 24;
+        }
+    }
+
+    return Buffer.concat([
+        Buffer.from([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]),
+        pngChunk('IHDR', header),
+        pngChunk('IDAT', zlib.deflateSync(pixels)),
+        pngChunk('IEND', Buffer.alloc(0))
+    ]);
+}
+
+function jpegSegment(marker, data) {
+    const header = Buffer.from([0xFF, marker, (data.length + 2) >> 8, (data.length + 2) & 0xFF]);
+    return Buffer.concat([header, Buffer.from(data)]);
+}
+
+// A baseline grayscale JPEG of flat mid-gray. Every block codes as a zero
+// DC difference followed by end-of-block, one bit each.
+function createJpeg(width, height) {
+    const blocks = Math.ceil(width / 8) * Math.ceil(height / 8);
+    const scan = Buffer.alloc(Math.ceil(blocks * 2 / 8));
+    const padding = scan.length * 8 - blocks * 2;
+    if(padding > 0)
+        scan[scan.length - 1] = (1 << padding) - 1;
+    const singleCode = [1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0];
+    return Buffer.concat([
+        Buffer.from([0xFF, 0xD8]),
+        jpegSegment(0xDB, [0, ...new Array(64).fill(1)]),
+        jpegSegment(0xC0, [8, height >> 8, height & 0xFF, width >> 8, width & 0xFF, 1, 1, 0x11, 0]),
+        jpegSegment(0xC4, [0x00, ...singleCode]),
+        jpegSegment(0xC4, [0x10, ...singleCode]),
+        jpegSegment(0xDA, [1, 1, 0x00, 0, 63, 0]),
+        scan,
+        Buffer.from([0xFF, 0xD9])
+    ]);
+}
+
+module.exports = { createPng, createJpeg };
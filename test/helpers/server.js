@@ -0,0 +1,59 @@
+'use strict';
+
+const { Worker } = require('node:worker_threads');
+
+// Book loads block the main thread, so the fixture server runs on a worker.
+const SERVER = `
+const http = require('node:http');
+const { parentPort, workerData } = require('node:worker_threads');
+const log = [];
+let active = 0;
+let maxActive = 0;
+const server = http.createServer((request, response) => {
+    log.push(request.url);
+    active++;
+    maxActive = Math.max(maxActive, active);
+    const resource = workerData.resources[request.url];
+    setTimeout(() => {
+        active--;
+        if(resource === undefined) {
+            response.writeHead(404);
+            response.end();
+            return;
+        }
+
+        response.writeHead(200, { 'Content-Type': resource.type });
+        response.end(resource.body);
+    }, resource && resource.delay !== undefined ? resource.delay : workerData.delay);
+});
+
+parentPort.on('message', (message) => {
+    if(message === 'stats') {
+        parentPort.postMessage({ log: log.splice(0), maxActive });
+        maxActive = 0;
+    } else {
+        server.close();
+        parentPort.close();
+    }
+});
+
+server.listen(0, '127.0.0.1', () => parentPort.postMessage(server.address().port));
+`;
+
+// Serves `resources`, a map of path to { type, body, delay }, delaying each
+// response by `delay` milliseconds unless the resource sets its own.
+function startServer(resources, delay = 0) {
+    const worker = new Worker(SERVER, { eval: true, workerData: { resources, delay } });
+    const reply = () => new Promise((resolve) => worker.once('message', resolve));
+    return reply().then((port) => ({
+        origin: `http://127.0.0.1:${port}`,
+        stats: () => {
+            const stats = reply();
+            worker.postMessage('stats');
+            return stats;
+        },
+        close: () => worker.postMessage('close')
+    }));
+}
+
+module.exports = { startServer };
@@ -0,0 +1,45 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+const { createPng, createJpeg } = require('./helpers/images');
+
+const PAGE = { width: '2in', height: '2in', margin: 0 };
+
+function loadImage(image, options) {
+    const book = plutoprint.createBook({ ...PAGE, resources: { 'https://example.com/image': image }, offline: true, recordSnapshot: true, ...options });
+    return book.loadHtml('<img src="image">', { baseUrl: 'https://example.com/' });
+}
+
+test('maxImageDpi keeps the intrinsic size of downsampled images', () => {
+    const cases = [
+        [1000, 300, createPng, 'image/png'],
+        [4000, 1200, createJpeg, 'image/jpeg']
+    ];
+
+    for(const [width, height, createImage, mimeType] of cases) {
+        const image = createImage(width, height);
+        const snapshot = loadImage(image, { maxImageDpi: 72 }).saveSnapshot();
+        assert.ok(snapshot.includes(`<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink" width="${width}" height="${height}"`));
+        assert.ok(snapshot.includes(`data:${mimeType};base64,`));
+        assert.ok(snapshot.length < image.length);
+    }
+});
+
+test('maxImageDpi leaves small images untouched', () => {
+    const image = createPng(100, 30);
+    const snapshot = loadImage(image, { maxImageDpi: 72 }).saveSnapshot();
+    assert.ok(snapshot.includes(image));
+    assert.ok(!snapshot.includes('<svg'));
+});
+
+test('maxImageDpi does not change layout', () => {
+    const image = createPng(100, 3000);
+    const original = loadImage(image, {});
+    const downsampled = loadImage(image, { maxImageDpi: 72 });
+    assert.ok(downsampled.saveSnapshot().length < image.length);
+    assert.strictEqual(downsampled.pageCount, original.pageCount);
+    assert.strictEqual(downsampled.documentWidth, original.documentWidth);
+    assert.strictEqual(downsampled.documentHeight, original.documentHeight);
+});
@@ -0,0 +1,70 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+const { startServer } = require('./helpers/server');
+
+const RESOURCES = {
+    'https://example.com/a.png': Buffer.alloc(600),
+    'https://example.com/b.png': Buffer.alloc(600),
+    'https://example.com/c.png': Buffer.alloc(600)
+};
+
+const IMAGES = '<img src="a.png"><img src="b.png"><img src="c.png">';
+
+function limitError(limit, max) {
+    return { name: 'Error', code: 'ERR_PLUTOPRINT_LIMIT', limit, max, message: `Limit \`${limit}\` of ${max} exceeded` };
+}
+
+function loadImages(options) {
+    const book = plutoprint.createBook({ resources: RESOURCES, offline: true, ...options });
+    return book.loadHtml(IMAGES, { baseUrl: 'https://example.com/' });
+}
+
+test('limits reject negative values', () => {
+    for(const limit of ['maxPages', 'maxCanvasPixels', 'maxResourceBytes', 'maxResourceCount', 'maxLayoutMs'])
+        assert.throws(() => plutoprint.createBook({ [limit]: -1 }), RangeError);
+});
+
+test('maxPages fails loads that paginate past the limit', () => {
+    const html = '<p>one</p><p style="break-before: page">two</p><p style="break-before: page">three</p>';
+    assert.strictEqual(plutoprint.createBook({ maxPages: 3 }).loadHtml(html).pageCount, 3);
+
+    const book = plutoprint.createBook({ maxPages: 2 });
+    assert.throws(() => book.loadHtml(html), limitError('maxPages', 2));
+    assert.strictEqual(book.pageCount, 0);
+});
+
+test('maxResourceCount fails loads that fetch too many resources', () => {
+    loadImages({ maxResourceCount: 3 });
+    assert.throws(() => loadImages({ maxResourceCount: 2 }), limitError('maxResourceCount', 2));
+});
+
+test('maxResourceBytes fails loads that fetch too many bytes', () => {
+    loadImages({ maxResourceBytes: 1800 });
+    assert.throws(() => loadImages({ maxResourceBytes: 1799 }), limitError('maxResourceBytes', 1799));
+});
+
+test('maxCanvasPixels fails PNG output and regions above the limit', () => {
+    const book = plutoprint.createBook({ width: '100px', height: '100px', margin: 0, maxCanvasPixels: 10000 });
+    book.loadHtml('<p>x</p>');
+    book.writeToPngBuffer();
+    assert.throws(() => book.writeToPngBuffer({ scale: 2 }), limitError('maxCanvasPixels', 10000));
+    assert.throws(() => book.writeToPngInto(Buffer.alloc(1 << 20), { width: 200 }), limitError('maxCanvasPixels', 10000));
+    book.renderRegion(0, { width: 100, height: 100 });
+    assert.throws(() => book.renderRegion(0, { width: 100, height: 100, scale: 1.5 }), limitError('maxCanvasPixels', 10000));
+    assert.throws(() => book.renderRegion(0, { width: 100, height: 100, scale: 1.5, format: 'raw' }), limitError('maxCanvasPixels', 10000));
+});
+
+test('maxLayoutMs fails loads that take too long', async (t) => {
+    const server = await startServer({
+        '/a.png': { type: 'image/png', body: 'a' },
+        '/b.png': { type: 'image/png', body: 'b' }
+    }, 50);
+    t.after(() => server.close());
+
+    const load = (maxLayoutMs) => plutoprint.createBook({ maxLayoutMs }).loadHtml('<img src="a.png"><img src="b.png">', { baseUrl: `${server.origin}/` });
+    load(5000);
+    assert.throws(() => load(20), limitError('maxLayoutMs', 20));
+});
@@ -0,0 +1,71 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const plutoprint = require('..');
+
+const PAGE = { width: '64px', height: '48px', margin: 0 };
+
+function createBook(options) {
+    const book = plutoprint.createBook(options);
+    book.loadHtml('<div style="break-after:page">Page</div>'.repeat(2) + '<div>Page</div>');
+    return book;
+}
+
+test('options handles render the same output as plain objects', async (t) => {
+    const book = createBook(PAGE);
+    const handleBook = createBook(plutoprint.createBookOptions(PAGE));
+    assert.strictEqual(handleBook.pageCount, book.pageCount);
+    assert.strictEqual(handleBook.documentWidth, book.documentWidth);
+
+    const pdf = { pageStart: 2, pageEnd: 3 };
+    const pdfHandle = plutoprint.createPdfOptions(pdf);
+    const expectedPdf = book.writeToPdfBuffer(pdf);
+    assert.deepStrictEqual(book.writeToPdfBuffer(pdfHandle), expectedPdf);
+    assert.deepStrictEqual(await book.writeToPdfAsync(pdfHandle), expectedPdf);
+
+    const png = { scale: 2 };
+    const pngHandle = plutoprint.createPngOptions(png);
+    const expectedPng = book.writeToPngBuffer(png);
+    assert.deepStrictEqual(book.writeToPngBuffer(pngHandle), expectedPng);
+
+    const directory = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-'));
+    t.after(() => fs.rmSync(directory, { recursive: true, force: true }));
+    book.writeToPdf(path.join(directory, 'out.pdf'), pdfHandle);
+    assert.deepStrictEqual(fs.readFileSync(path.join(directory, 'out.pdf')), expectedPdf);
+    book.writeToPng(path.join(directory, 'out.png'), pngHandle);
+    assert.deepStrictEqual(fs.readFileSync(path.join(directory, 'out.png')), expectedPng);
+});
+
+test('options handles are frozen and validated when created', () => {
+    const handle = plutoprint.createPdfOptions({ pageStart: 1 });
+    assert.ok(Object.isFrozen(handle));
+    assert.deepStrictEqual(Object.keys(handle), []);
+
+    assert.throws(() => plutoprint.createBookOptions({ size: 'bogus' }), TypeError);
+    assert.throws(() => plutoprint.createPdfOptions({ pageStart: 'first' }), TypeError);
+    assert.throws(() => plutoprint.createPngOptions({ scale: 'double' }), TypeError);
+    assert.throws(() => plutoprint.createPngOptions(), TypeError);
+});
+
+test('options handles of the wrong kind are rejected', async () => {
+    const book = createBook(PAGE);
+    const bookHandle = plutoprint.createBookOptions(PAGE);
+    const pdfHandle = plutoprint.createPdfOptions({ pageStart: 2 });
+    const pngHandle = plutoprint.createPngOptions({ scale: 2 });
+    const target = Buffer.alloc(1 << 20);
+
+    assert.throws(() => plutoprint.createBook(pdfHandle), { name: 'TypeError', message: 'Argument 1 must be a BookOptions, not a PdfOptions' });
+    assert.throws(() => new plutoprint.Book(pngHandle), { name: 'TypeError', message: 'Argument 1 must be a BookOptions, not a PngOptions' });
+    assert.throws(() => book.writeToPdfBuffer(pngHandle), { name: 'TypeError', message: 'Argument 1 must be a PdfOptions, not a PngOptions' });
+    assert.throws(() => book.writeToPdfInto(target, bookHandle), { name: 'TypeError', message: 'Argument 2 must be a PdfOptions, not a BookOptions' });
+    assert.throws(() => book.writeToPdf('unused.pdf', pngHandle), { name: 'TypeError', message: 'Argument 2 must be a PdfOptions, not a PngOptions' });
+    assert.throws(() => book.writeToPngBuffer(pdfHandle), { name: 'TypeError', message: 'Argument 1 must be a PngOptions, not a PdfOptions' });
+    assert.throws(() => book.writeToPngInto(target, pdfHandle), { name: 'TypeError', message: 'Argument 2 must be a PngOptions, not a PdfOptions' });
+    assert.throws(() => book.writeToPng('unused.png', bookHandle), { name: 'TypeError', message: 'Argument 2 must be a PngOptions, not a BookOptions' });
+    await assert.rejects(async () => book.writeToPdfAsync(pngHandle), { name: 'TypeError', message: 'Argument 1 must be a PdfOptions, not a PngOptions' });
+    assert.ok(!fs.existsSync('unused.pdf') && !fs.existsSync('unused.png'));
+});
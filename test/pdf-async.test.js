@@ -0,0 +1,67 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+
+const PAGE_COUNT = 20;
+
+function createBook() {
+    const book = plutoprint.createBook();
+    book.loadHtml(Array.from({ length: PAGE_COUNT }, (_, i) => `<p style="break-before: page">Page ${i + 1}</p>`).join('').replace('break-before: page', ''));
+    assert.strictEqual(book.pageCount, PAGE_COUNT);
+    return book;
+}
+
+test('writeToPdfAsync emits contiguous page events in page order', async () => {
+    const book = createBook();
+    const events = [];
+    const pdf = await book.writeToPdfAsync({ onPage: (event) => events.push(event) });
+
+    assert.deepStrictEqual(events.map((event) => event.pageIndex), Array.from({ length: PAGE_COUNT }, (_, i) => i));
+    let offset = 0;
+    for(const event of events) {
+        assert.strictEqual(event.byteOffset, offset);
+        assert.deepStrictEqual(event.data, pdf.subarray(offset, offset + event.data.length));
+        offset += event.data.length;
+    }
+
+    for(let i = 1; i < events.length; i++)
+        assert.ok(events[i].elapsed >= events[i - 1].elapsed);
+    assert.deepStrictEqual(pdf, book.writeToPdfBuffer());
+});
+
+test('writeToPdfAsync honours the page range', async () => {
+    const book = createBook();
+    const pages = [];
+    await book.writeToPdfAsync({ pageStart: 10, pageEnd: 4, pageStep: -3, onPage: ({ pageIndex }) => pages.push(pageIndex) });
+    assert.deepStrictEqual(pages, [9, 6, 3]);
+});
+
+test('writeToPdfAsync makes the book busy until it settles', async () => {
+    const book = createBook();
+    const promise = book.writeToPdfAsync();
+    assert.throws(() => book.pageCount, { code: 'ERR_PLUTOPRINT_BUSY' });
+    assert.throws(() => book.writeToPdfBuffer(), { code: 'ERR_PLUTOPRINT_BUSY' });
+    assert.throws(() => book.writeToPdfAsync(), { code: 'ERR_PLUTOPRINT_BUSY' });
+    await promise;
+    assert.strictEqual(book.pageCount, PAGE_COUNT);
+});
+
+test('writeToPdfAsync stops rendering when onPage throws', async () => {
+    const book = createBook();
+    const error = new Error('stop');
+    const pages = [];
+    const rendersBefore = plutoprint.metrics().renders.pdf.failures;
+    await assert.rejects(book.writeToPdfAsync({
+        onPage: ({ pageIndex }) => {
+            pages.push(pageIndex);
+            if(pageIndex === 1)
+                throw error;
+        }
+    }), (reason) => reason === error);
+
+    assert.deepStrictEqual(pages, [0, 1]);
+    assert.strictEqual(plutoprint.metrics().renders.pdf.failures, rendersBefore + 1);
+    assert.strictEqual(book.pageCount, PAGE_COUNT);
+});
@@ -0,0 +1,63 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+const { startServer } = require('./helpers/server');
+
+const IMAGES = ['a.png', 'b.png', 'c.png', 'd.png'];
+
+const RESOURCES = {
+    '/index.html': {
+        type: 'text/html',
+        delay: 0,
+        body: `<html><head><script src='unused.js'></script></head><body>${IMAGES.map((name) => `<img src="${name}">`).join('')}<input type='text' src='unused.png'></body></html>`
+    },
+    '/unused.js': { type: 'text/javascript', body: 'void 0;' },
+    '/unused.png': { type: 'image/png', body: 'not really a png' }
+};
+
+for(const name of IMAGES)
+    RESOURCES[`/${name}`] = { type: 'image/png', body: 'not really a png' };
+
+test('loadUrl', async (t) => {
+    const server = await startServer(RESOURCES, 100);
+    server.url = `${server.origin}/index.html`;
+    t.after(() => server.close());
+
+    await t.test('fetches subresources one at a time without prefetch', async () => {
+        plutoprint.createBook().loadUrl(server.url);
+        const { log, maxActive } = await server.stats();
+        assert.strictEqual(log[0], '/index.html');
+        assert.deepStrictEqual(log.slice(1).sort(), IMAGES.map((name) => `/${name}`));
+        assert.strictEqual(maxActive, 1);
+    });
+
+    await t.test('prefetches every image concurrently before loading and skips scripts', async () => {
+        const start = process.hrtime.bigint();
+        plutoprint.createBook().loadUrl(server.url, { prefetch: true, prefetchConcurrency: 8 });
+        const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+        const { log, maxActive } = await server.stats();
+        assert.strictEqual(log[0], '/index.html');
+        assert.deepStrictEqual(log.slice(1).sort(), IMAGES.map((name) => `/${name}`));
+        assert.strictEqual(maxActive, IMAGES.length);
+        assert.ok(elapsed < 100 * IMAGES.length, `took ${elapsed} ms`);
+    });
+
+    await t.test('caps the number of concurrent fetches', async () => {
+        plutoprint.createBook().loadUrl(server.url, { prefetch: true, prefetchConcurrency: 2 });
+        const { log, maxActive } = await server.stats();
+        assert.strictEqual(log.length, IMAGES.length + 1);
+        assert.strictEqual(maxActive, 2);
+    });
+
+    await t.test('counts only prefetched resources the document uses against limits', async () => {
+        const book = plutoprint.createBook({ maxResourceCount: IMAGES.length + 1 });
+        book.loadUrl(server.url, { prefetch: true });
+        await server.stats();
+        assert.throws(() => plutoprint.createBook({ maxResourceCount: IMAGES.length }).loadUrl(server.url, { prefetch: true }), {
+            code: 'ERR_PLUTOPRINT_LIMIT'
+        });
+        await server.stats();
+    });
+});
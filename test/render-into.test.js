@@ -0,0 +1,79 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+
+function createBook() {
+    const book = plutoprint.createBook({ width: '64px', height: '48px', margin: 0 });
+    book.loadHtml('<div style="width:32px;height:24px;background:#c33"></div>');
+    return book;
+}
+
+function tooSmall(required) {
+    return { name: 'RangeError', code: 'ERR_BUFFER_TOO_SMALL', required };
+}
+
+test('writeToPdfInto and writeToPngInto match the buffer methods', () => {
+    const book = createBook();
+    const cases = [
+        [book.writeToPdfBuffer(), (target) => book.writeToPdfInto(target)],
+        [book.writeToPngBuffer(), (target) => book.writeToPngInto(target)],
+        [book.writeToPngBuffer({ scale: 2 }), (target) => book.writeToPngInto(target, plutoprint.createPngOptions({ scale: 2 }))]
+    ];
+
+    for(const [expected, write] of cases) {
+        const target = Buffer.alloc(expected.length + 16);
+        assert.strictEqual(write(target), expected.length);
+        assert.deepStrictEqual(target.subarray(0, expected.length), expected);
+
+        const exact = new Uint8Array(new SharedArrayBuffer(expected.length));
+        assert.strictEqual(write(exact), expected.length);
+        assert.deepStrictEqual(Buffer.from(exact), expected);
+
+        assert.throws(() => write(Buffer.alloc(expected.length - 1)), tooSmall(expected.length));
+        assert.throws(() => write(new ArrayBuffer(0)), tooSmall(expected.length));
+    }
+});
+
+test('renderRegionInto writes PNG and raw output', () => {
+    const book = createBook();
+    const region = { x: 8, y: 8, width: 20, height: 10, scale: 2 };
+
+    const png = book.renderRegion(0, region);
+    const target = new ArrayBuffer(png.length);
+    assert.strictEqual(book.renderRegionInto(target, 0, region), png.length);
+    assert.deepStrictEqual(Buffer.from(target), png);
+    assert.throws(() => book.renderRegionInto(Buffer.alloc(png.length - 1), 0, region), tooSmall(png.length));
+
+    const raw = book.renderRegion(0, { ...region, format: 'raw' });
+    assert.strictEqual(raw.length, 40 * 20 * 4);
+    const pixels = new Uint32Array(40 * 20);
+    assert.strictEqual(book.renderRegionInto(pixels, 0, { ...region, format: 'raw' }), raw.length);
+    assert.deepStrictEqual(Buffer.from(pixels.buffer), raw);
+});
+
+test('renderRegionInto rejects raw targets before touching them', () => {
+    const book = createBook();
+    const region = { width: 10, height: 10, format: 'raw' };
+
+    const small = Buffer.alloc(399, 0xAB);
+    assert.throws(() => book.renderRegionInto(small, 0, region), tooSmall(400));
+    assert.ok(small.every((byte) => byte === 0xAB));
+
+    const unaligned = new Uint8Array(new ArrayBuffer(404), 1, 400);
+    assert.throws(() => book.renderRegionInto(unaligned, 0, region), RangeError);
+});
+
+test('render targets must be buffers, typed arrays or array buffers', () => {
+    const book = createBook();
+    for(const target of [null, 'buffer', [0, 0, 0, 0], new DataView(new ArrayBuffer(8))])
+        assert.throws(() => book.writeToPdfInto(target), TypeError);
+});
+
+test('regions are bounded before anything is allocated', () => {
+    const book = createBook();
+    assert.throws(() => book.renderRegion(0, { width: 64, height: 48, scale: 1000, format: 'raw' }), RangeError);
+    assert.throws(() => book.renderRegion(0, { width: 64, height: 48, scale: 400, format: 'raw' }), /exceeds the maximum/);
+    assert.throws(() => book.renderRegion(0, { width: 0 }), RangeError);
+});
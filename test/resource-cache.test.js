@@ -0,0 +1,87 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const plutoprint = require('..');
+const { startServer } = require('./helpers/server');
+
+const RESOURCES = {
+    '/a.png': { type: 'image/png', body: 'a'.repeat(1000) },
+    '/b.png': { type: 'image/png', body: 'b'.repeat(1000) }
+};
+
+for(let i = 0; i < 100; i++)
+    RESOURCES[`/empty-${i}.png`] = { type: 'image/png', body: '' };
+
+test('resource cache', async (t) => {
+    const server = await startServer(RESOURCES);
+    t.after(() => {
+        plutoprint.setResourceCacheSize(0);
+        plutoprint.clearResourceCache();
+        server.close();
+    });
+
+    // One book per image, since an engine may deduplicate fetches within a document.
+    const load = (...names) => {
+        for(const name of names)
+            plutoprint.createBook().loadHtml(`<img src="${name}">`, { baseUrl: `${server.origin}/` });
+    };
+
+    t.beforeEach(async () => {
+        plutoprint.setResourceCacheSize(0);
+        plutoprint.clearResourceCache();
+        await server.stats();
+    });
+
+    await t.test('is disabled until a size is set', async () => {
+        load('a.png');
+        load('a.png');
+        assert.deepStrictEqual((await server.stats()).log, ['/a.png', '/a.png']);
+        assert.deepStrictEqual(plutoprint.getResourceCacheStats(), { capacity: 0, size: 0, count: 0, hits: 0, misses: 0, evictions: 0 });
+    });
+
+    await t.test('serves repeated fetches from memory', async () => {
+        plutoprint.setResourceCacheSize(1 << 20);
+        load('a.png');
+        load('a.png', 'b.png');
+        assert.deepStrictEqual((await server.stats()).log, ['/a.png', '/b.png']);
+
+        const stats = plutoprint.getResourceCacheStats();
+        assert.strictEqual(stats.hits, 1);
+        assert.strictEqual(stats.misses, 2);
+        assert.strictEqual(stats.count, 2);
+        assert.ok(stats.size > 2000);
+    });
+
+    await t.test('evicts the least recently used entry to stay within budget', async () => {
+        plutoprint.setResourceCacheSize(1500);
+        load('a.png', 'b.png', 'b.png', 'a.png');
+        assert.deepStrictEqual((await server.stats()).log, ['/a.png', '/b.png', '/a.png']);
+
+        const stats = plutoprint.getResourceCacheStats();
+        assert.deepStrictEqual([stats.hits, stats.misses, stats.evictions, stats.count], [1, 3, 2, 1]);
+        assert.ok(stats.size <= 1500);
+
+        plutoprint.setResourceCacheSize(100);
+        assert.deepStrictEqual([plutoprint.getResourceCacheStats().count, plutoprint.getResourceCacheStats().evictions], [0, 3]);
+    });
+
+    await t.test('charges empty bodies so they cannot grow the cache without bound', async () => {
+        plutoprint.setResourceCacheSize(0);
+        load(...Object.keys(RESOURCES).filter((name) => name.startsWith('/empty-')).map((name) => name.slice(1)));
+        assert.strictEqual(plutoprint.getResourceCacheStats().count, 0);
+
+        plutoprint.setResourceCacheSize(2000);
+        load(...Object.keys(RESOURCES).filter((name) => name.startsWith('/empty-')).map((name) => name.slice(1)));
+        const stats = plutoprint.getResourceCacheStats();
+        assert.ok(stats.count > 0 && stats.count < 100, `count is ${stats.count}`);
+        assert.ok(stats.size <= 2000);
+    });
+
+    await t.test('clearResourceCache drops entries and resets counters', async () => {
+        plutoprint.setResourceCacheSize(1 << 20);
+        load('a.png', 'a.png');
+        plutoprint.clearResourceCache();
+        assert.deepStrictEqual(plutoprint.getResourceCacheStats(), { capacity: 1 << 20, size: 0, count: 0, hits: 0, misses: 0, evictions: 0 });
+    });
+});
@@ -0,0 +1,143 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const { pathToFileURL } = require('node:url');
+const plutoprint = require('..');
+
+const DOCUMENT = Buffer.from('<html><body><img src="logo.png"></body></html>');
+const LOGO = Buffer.from('not really a png');
+
+function tarEntry(name, content, type = '0') {
+    const header = Buffer.alloc(512);
+    header.write(name, 0, 100);
+    header.write('0000644\0', 100);
+    header.write(content.length.toString(8).padStart(11, '0') + '\0', 124);
+    header.write('        ', 148);
+    header.write(type, 156);
+    header.write('ustar\0' + '00', 257);
+    let checksum = 0;
+    for(const byte of header)
+        checksum += byte;
+    header.write(checksum.toString(8).padStart(6, '0') + '\0 ', 148);
+    return Buffer.concat([header, content, Buffer.alloc((512 - content.length % 512) % 512)]);
+}
+
+function createTar(entries) {
+    const blocks = Object.entries(entries).map(([name, content]) => tarEntry(name, content));
+    blocks.push(Buffer.alloc(1024));
+    return Buffer.concat(blocks);
+}
+
+function paxRecord(keyword, value) {
+    const body = ` ${keyword}=${value}\n`;
+    let length = body.length + 1;
+    while(String(length).length + body.length !== length)
+        length++;
+    return length + body;
+}
+
+function fetchDelta(callback) {
+    const before = plutoprint.metrics();
+    callback();
+    const after = plutoprint.metrics();
+    return { fetches: after.fetches - before.fetches, failures: after.fetchFailures - before.fetchFailures };
+}
+
+test('resources serves a plain object by full URL', () => {
+    const book = plutoprint.createBook({
+        resources: { 'https://example.com/index.html': DOCUMENT, 'https://example.com/logo.png': LOGO },
+        offline: true
+    });
+
+    const delta = fetchDelta(() => book.loadUrl('https://example.com/index.html'));
+    assert.deepStrictEqual(delta, { fetches: 2, failures: 0 });
+});
+
+test('resources matches scheme-less keys for any scheme', () => {
+    const resources = { 'example.com/index.html': DOCUMENT, 'example.com/logo.png': LOGO };
+    for(const url of ['https://example.com/index.html', 'http://example.com/index.html']) {
+        const book = plutoprint.createBook({ resources, offline: true });
+        assert.deepStrictEqual(fetchDelta(() => book.loadUrl(url)), { fetches: 2, failures: 0 });
+    }
+});
+
+test('resources accepts a Map', () => {
+    const resources = new Map([['https://example.com/index.html', DOCUMENT], ['https://example.com/logo.png', LOGO]]);
+    const book = plutoprint.createBook({ resources, offline: true });
+    assert.deepStrictEqual(fetchDelta(() => book.loadUrl('https://example.com/index.html')), { fetches: 2, failures: 0 });
+});
+
+test('resources serves a tar bundle', (t) => {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-test-'));
+    t.after(() => fs.rmSync(dir, { recursive: true, force: true }));
+
+    const bundle = path.join(dir, 'assets.tar');
+    fs.writeFileSync(bundle, createTar({ 'example.com/index.html': DOCUMENT, 'example.com/logo.png': LOGO }));
+    const book = plutoprint.createBook({ resources: bundle, offline: true });
+    assert.deepStrictEqual(fetchDelta(() => book.loadUrl('https://example.com/index.html')), { fetches: 2, failures: 0 });
+    assert.throws(() => plutoprint.createBook({ resources: path.join(dir, 'missing.tar') }), /could not open/);
+});
+
+test('resources reads pax path records', (t) => {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-test-'));
+    t.after(() => fs.rmSync(dir, { recursive: true, force: true }));
+
+    const name = `example.com/${'nested/'.repeat(20)}logo.png`;
+    const pax = Buffer.from(paxRecord('mtime', '0') + paxRecord('path', name));
+    const bundle = path.join(dir, 'assets.tar');
+    fs.writeFileSync(bundle, Buffer.concat([tarEntry('PaxHeader', pax, 'x'), tarEntry('short.png', LOGO), Buffer.alloc(1024)]));
+
+    const book = plutoprint.createBook({ resources: bundle, offline: true });
+    const delta = fetchDelta(() => book.loadHtml(`<img src="${'nested/'.repeat(20)}logo.png">`, { baseUrl: 'https://example.com/' }));
+    assert.deepStrictEqual(delta, { fetches: 1, failures: 0 });
+});
+
+test('resources ignores malformed pax records', (t) => {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-test-'));
+    t.after(() => fs.rmSync(dir, { recursive: true, force: true }));
+
+    const records = ['5 path', '6 path', '99 path=logo.png\n', '0 path=x\n', 'path=x\n', '99999999999999999999999 path=x\n', '12 x=y\n7 path='];
+    for(const [index, record] of records.entries()) {
+        const bundle = path.join(dir, `malformed-${index}.tar`);
+        fs.writeFileSync(bundle, Buffer.concat([tarEntry('PaxHeader', Buffer.from(record), 'x'), tarEntry('example.com/logo.png', LOGO), Buffer.alloc(1024)]));
+        const book = plutoprint.createBook({ resources: bundle, offline: true });
+        const delta = fetchDelta(() => book.loadHtml(DOCUMENT.toString(), { baseUrl: 'https://example.com/' }));
+        assert.deepStrictEqual(delta, { fetches: 1, failures: 0 }, record);
+    }
+
+    // Length digits that run to the end of the mapping must not be read past it.
+    const bundle = path.join(dir, 'digits.tar');
+    const digits = Buffer.alloc(4096 - 512, '1');
+    fs.writeFileSync(bundle, Buffer.concat([tarEntry('PaxHeader', digits, 'x')]));
+    assert.strictEqual(fs.statSync(bundle).size, 4096);
+    plutoprint.createBook({ resources: bundle });
+});
+
+test('resources rejects anything but a string, plain object or Map', () => {
+    for(const resources of [[], Buffer.alloc(0), new (class Resources {})(), 42])
+        assert.throws(() => plutoprint.createBook({ resources }), TypeError);
+    assert.throws(() => plutoprint.createBook({ resources: { 'https://example.com/': 'text' } }), TypeError);
+    assert.throws(() => plutoprint.createBook({ resources: new Map([[1, LOGO]]) }), TypeError);
+    plutoprint.createBook({ resources: Object.create(null) });
+});
+
+test('offline fails network URLs missing from resources', () => {
+    const book = plutoprint.createBook({ resources: { 'https://example.com/index.html': DOCUMENT }, offline: true });
+    assert.throws(() => book.loadUrl('https://example.com/other.html'), /not available offline/);
+    assert.deepStrictEqual(fetchDelta(() => book.loadUrl('https://example.com/index.html')), { fetches: 2, failures: 1 });
+});
+
+test('offline still reads file: and data: URLs', (t) => {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-test-'));
+    t.after(() => fs.rmSync(dir, { recursive: true, force: true }));
+
+    const file = path.join(dir, 'index.html');
+    fs.writeFileSync(file, '<p>local</p>');
+    const book = plutoprint.createBook({ offline: true });
+    book.loadUrl(pathToFileURL(file).href);
+    book.loadUrl('data:text/html,<p>inline</p>');
+});
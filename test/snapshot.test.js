@@ -0,0 +1,94 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const plutoprint = require('..');
+const { createPng } = require('./helpers/images');
+
+const OPTIONS = {
+    width: '2in',
+    height: '1in',
+    margin: '4px',
+    media: 'screen',
+    title: 'Catalog',
+    author: 'Sales',
+    resources: { 'https://example.com/logo.png': createPng(8, 8) },
+    recordSnapshot: true
+};
+
+const HTML = '<img src="logo.png"><div style="break-before:page">Page</div>';
+
+function createDirectory(t) {
+    const directory = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-'));
+    t.after(() => fs.rmSync(directory, { recursive: true, force: true }));
+    return directory;
+}
+
+function assertSameBook(actual, expected) {
+    assert.strictEqual(actual.pageCount, expected.pageCount);
+    assert.strictEqual(actual.documentWidth, expected.documentWidth);
+    assert.strictEqual(actual.documentHeight, expected.documentHeight);
+    assert.strictEqual(actual.viewportWidth, expected.viewportWidth);
+    assert.strictEqual(actual.viewportHeight, expected.viewportHeight);
+    assert.deepStrictEqual(actual.writeToPdfBuffer(), expected.writeToPdfBuffer());
+    assert.deepStrictEqual(actual.writeToPngBuffer(), expected.writeToPngBuffer());
+}
+
+test('loadSnapshot restores a saved book', (t) => {
+    const book = plutoprint.createBook(OPTIONS);
+    book.loadHtml(HTML, { baseUrl: 'https://example.com/' });
+    const snapshot = book.saveSnapshot();
+
+    const restored = plutoprint.loadSnapshot(snapshot);
+    assertSameBook(restored, book);
+    assert.deepStrictEqual(restored.saveSnapshot(), snapshot);
+
+    const file = path.join(createDirectory(t), 'book.snapshot');
+    fs.writeFileSync(file, snapshot);
+    const mapped = plutoprint.loadSnapshot(file);
+    assertSameBook(mapped, book);
+    assert.deepStrictEqual(mapped.saveSnapshot(), snapshot);
+});
+
+test('loadSnapshot keeps the limits and maxImageDpi of the saved book', (t) => {
+    const book = plutoprint.createBook({ ...OPTIONS, maxPages: 2, maxCanvasPixels: 40000, maxResourceCount: 2, maxImageDpi: 72 });
+    book.loadHtml(HTML, { baseUrl: 'https://example.com/' });
+    const restored = plutoprint.loadSnapshot(book.saveSnapshot());
+    assertSameBook(restored, book);
+
+    assert.throws(() => restored.writeToPngBuffer({ scale: 2 }), { code: 'ERR_PLUTOPRINT_LIMIT', limit: 'maxCanvasPixels', max: 40000 });
+    assert.throws(() => restored.loadHtml('<div style="break-after:page">Page</div>'.repeat(3)), { code: 'ERR_PLUTOPRINT_LIMIT', limit: 'maxPages', max: 2 });
+
+    const directory = createDirectory(t);
+    const files = ['a.png', 'b.png', 'c.png'].map((name) => path.join(directory, name));
+    files.forEach((file) => fs.writeFileSync(file, createPng(8, 8)));
+    const images = files.map((file) => `<img src="file://${file}">`);
+    assert.throws(() => restored.loadHtml(images.join('')), { code: 'ERR_PLUTOPRINT_LIMIT', limit: 'maxResourceCount', max: 2 });
+
+    const large = path.join(directory, 'large.png');
+    fs.writeFileSync(large, createPng(1000, 300));
+    restored.loadHtml(`<img src="file://${large}">`);
+    assert.ok(restored.saveSnapshot().includes('<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink" width="1000" height="300"'));
+});
+
+test('loadSnapshot restores books offline', () => {
+    const book = plutoprint.createBook({ ...OPTIONS, offline: false });
+    book.loadHtml(HTML, { baseUrl: 'https://example.com/' });
+    const restored = plutoprint.loadSnapshot(book.saveSnapshot());
+    assert.throws(() => restored.loadUrl('https://example.com/missing.html'), /not available offline/);
+});
+
+test('loadSnapshot rejects invalid snapshots', () => {
+    const book = plutoprint.createBook(OPTIONS);
+    book.loadHtml(HTML, { baseUrl: 'https://example.com/' });
+    const snapshot = book.saveSnapshot();
+
+    const previousVersion = Buffer.from(snapshot);
+    previousVersion.writeUInt32BE(1, 8);
+    for(const data of [previousVersion, snapshot.subarray(0, 40), snapshot.subarray(0, snapshot.length - 1), Buffer.alloc(0)])
+        assert.throws(() => plutoprint.loadSnapshot(data), /Invalid or unsupported snapshot data/);
+    assert.throws(() => plutoprint.loadSnapshot(path.join(os.tmpdir(), 'missing.snapshot')), /Could not open snapshot/);
+});
@@ -0,0 +1,77 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const plutoprint = require('..');
+
+function createBook(pages) {
+    const book = plutoprint.createBook({ width: '64px', height: '48px', margin: 0 });
+    book.loadHtml('<div style="break-after:page">Page</div>'.repeat(pages - 1) + '<div>Page</div>');
+    assert.strictEqual(book.pageCount, pages);
+    return book;
+}
+
+function createDirectory(t) {
+    const directory = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-'));
+    t.after(() => fs.rmSync(directory, { recursive: true, force: true }));
+    return directory;
+}
+
+function assertPdf(data) {
+    assert.strictEqual(data.subarray(0, 5).toString(), '%PDF-');
+}
+
+test('splitToPdf returns one buffer per range', () => {
+    const book = createBook(5);
+    const parts = book.splitToPdf({ ranges: [[1, 1], [2, 5], [3, 3]] });
+    assert.strictEqual(parts.length, 3);
+    parts.forEach(assertPdf);
+
+    assert.strictEqual(book.splitToPdf({ every: 2 }).length, 3);
+    assert.strictEqual(book.splitToPdf({ every: 5 }).length, 1);
+});
+
+test('splitToPdf caps every at the page count', () => {
+    const book = createBook(3);
+    for(const every of [4, 2 ** 53 - 1, 2 ** 63]) {
+        const parts = book.splitToPdf({ every });
+        assert.strictEqual(parts.length, 1);
+        assertPdf(parts[0]);
+    }
+});
+
+test('splitToPdf validates its options', () => {
+    const book = createBook(3);
+    assert.throws(() => book.splitToPdf({}), TypeError);
+    assert.throws(() => book.splitToPdf({ every: 1, ranges: [[1, 1]] }), TypeError);
+    assert.throws(() => book.splitToPdf({ every: -1 }), RangeError);
+    assert.throws(() => book.splitToPdf({ ranges: [[0, 1]] }), RangeError);
+    assert.throws(() => book.splitToPdf({ ranges: [[2, 1]] }), RangeError);
+    assert.throws(() => book.splitToPdf({ ranges: [[1, 4]] }), RangeError);
+    assert.throws(() => book.splitToPdf({ ranges: [1, 2] }), TypeError);
+    assert.throws(() => book.splitToPdf({ every: 1, path: 'part.pdf' }), TypeError);
+});
+
+test('splitToPdf writes numbered files', (t) => {
+    const directory = createDirectory(t);
+    const paths = createBook(3).splitToPdf({ every: 1, path: path.join(directory, 'page-%d.pdf') });
+    assert.deepStrictEqual(paths, [1, 2, 3].map((part) => path.join(directory, `page-${part}.pdf`)));
+    for(const file of paths)
+        assertPdf(fs.readFileSync(file));
+    assert.deepStrictEqual(fs.readdirSync(directory).sort(), ['page-1.pdf', 'page-2.pdf', 'page-3.pdf']);
+});
+
+test('splitToPdf leaves no files behind when a part fails', (t) => {
+    const directory = createDirectory(t);
+    fs.mkdirSync(path.join(directory, '1'));
+    fs.writeFileSync(path.join(directory, '1', 'part.pdf'), 'old');
+
+    const book = createBook(2);
+    assert.throws(() => book.splitToPdf({ every: 1, path: path.join(directory, '%d', 'part.pdf') }), /Unable to write/);
+    assert.deepStrictEqual(fs.readdirSync(directory), ['1']);
+    assert.deepStrictEqual(fs.readdirSync(path.join(directory, '1')), ['part.pdf']);
+    assert.strictEqual(fs.readFileSync(path.join(directory, '1', 'part.pdf'), 'utf8'), 'old');
+});
@@ -0,0 +1,156 @@
+'use strict';
+
+const test = require('node:test');
+const assert = require('node:assert');
+const fs = require('node:fs');
+const os = require('node:os');
+const path = require('node:path');
+const { spawn } = require('node:child_process');
+const { Worker } = require('node:worker_threads');
+const plutoprint = require('..');
+
+const posix = process.platform !== 'win32';
+
+function createBook() {
+    const book = plutoprint.createBook({ width: '64px', height: '48px', margin: 0 });
+    book.loadHtml('<p>Hello</p>');
+    return book;
+}
+
+function createDirectory(t) {
+    const directory = fs.mkdtempSync(path.join(os.tmpdir(), 'plutoprint-'));
+    t.after(() => fs.rmSync(directory, { recursive: true, force: true }));
+    return directory;
+}
+
+function assertPdf(data) {
+    assert.strictEqual(data.subarray(0, 5).toString(), '%PDF-');
+    assert.match(data.toString('latin1').trimEnd(), /%%EOF$/);
+}
+
+test('writeToPdf replaces regular files without leaving temporary files', (t) => {
+    const directory = createDirectory(t);
+    const target = path.join(directory, 'out.pdf');
+    fs.writeFileSync(target, 'old');
+    if(posix)
+        fs.chmodSync(target, 0o640);
+
+    createBook().writeToPdf(target);
+    assertPdf(fs.readFileSync(target));
+    assert.deepStrictEqual(fs.readdirSync(directory), ['out.pdf']);
+    if(posix) {
+        assert.strictEqual(fs.statSync(target).mode & 0o777, 0o640);
+    }
+});
+
+test('writeToPdf writes through symbolic links', { skip: !posix }, (t) => {
+    const directory = createDirectory(t);
+    const real = path.join(directory, 'real.pdf');
+    const link = path.join(directory, 'link.pdf');
+    fs.writeFileSync(real, 'old');
+    fs.symlinkSync(real, link);
+
+    createBook().writeToPdf(link);
+    assert.ok(fs.lstatSync(link).isSymbolicLink());
+    assertPdf(fs.readFileSync(real));
+    assert.deepStrictEqual(fs.readdirSync(directory).sort(), ['link.pdf', 'real.pdf']);
+
+    const dangling = path.join(directory, 'dangling.pdf');
+    const missing = path.join(directory, 'missing.pdf');
+    fs.symlinkSync(missing, dangling);
+    createBook().writeToPng(dangling);
+    assert.ok(fs.lstatSync(dangling).isSymbolicLink());
+    assert.ok(fs.statSync(missing).size > 0);
+});
+
+test('writeToPdf writes FIFOs in place', { skip: !posix }, async (t) => {
+    const directory = createDirectory(t);
+    const fifo = path.join(directory, 'fifo');
+    const output = path.join(directory, 'output.pdf');
+    const mkfifo = spawn('mkfifo', [fifo]);
+    const created = await new Promise((resolve) => {
+        mkfifo.on('error', () => resolve(false));
+        mkfifo.on('exit', (code) => resolve(code === 0));
+    });
+
+    if(!created) {
+        t.skip('mkfifo is not available');
+        return;
+    }
+
+    const reader = spawn('sh', ['-c', 'exec cat "$0" > "$1"', fifo, output], { stdio: 'ignore' });
+    const exited = new Promise((resolve) => reader.on('exit', resolve));
+    const timer = setTimeout(() => reader.kill(), 5000);
+    createBook().writeToPdf(fifo, { sync: 'full' });
+    const code = await exited;
+    clearTimeout(timer);
+    assert.strictEqual(code, 0);
+
+    assert.ok(fs.lstatSync(fifo).isFIFO());
+    assertPdf(fs.readFileSync(output));
+    assert.deepStrictEqual(fs.readdirSync(directory).sort(), ['fifo', 'output.pdf']);
+});
+
+function directIoSupported(directory) {
+    if(fs.constants.O_DIRECT === undefined)
+        return false;
+    try {
+        fs.closeSync(fs.openSync(path.join(directory, 'probe'), fs.constants.O_WRONLY | fs.constants.O_CREAT | fs.constants.O_DIRECT));
+        return true;
+    } catch {
+        return false;
+    } finally {
+        fs.rmSync(path.join(directory, 'probe'), { force: true });
+    }
+}
+
+function findTemporaryFileFlags(directory) {
+    for(const fd of fs.readdirSync('/proc/self/fd')) {
+        try {
+            const link = fs.readlinkSync(`/proc/self/fd/${fd}`);
+            if(!link.startsWith(directory) || !link.endsWith('.tmp'))
+                continue;
+            const match = /^flags:\s+([0-7]+)$/m.exec(fs.readFileSync(`/proc/self/fdinfo/${fd}`, 'utf8'));
+            if(match) {
+                return parseInt(match[1], 8);
+            }
+        } catch {
+        }
+    }
+
+    return null;
+}
+
+test('directIo opens the temporary file with O_DIRECT', { skip: process.platform !== 'linux' }, async (t) => {
+    const directory = createDirectory(t);
+    if(!directIoSupported(directory)) {
+        t.skip('the file system does not support O_DIRECT');
+        return;
+    }
+
+    const stop = new Int32Array(new SharedArrayBuffer(4));
+    const worker = new Worker(`
+        const { workerData } = require('node:worker_threads');
+        const plutoprint = require(workerData.module);
+        const book = plutoprint.createBook({ width: '64px', height: '48px', margin: 0 });
+        book.loadHtml('<div style="break-after:page">Page</div>'.repeat(2000));
+        while(Atomics.load(workerData.stop, 0) === 0)
+            book.writeToPdf(workerData.target, { directIo: true, bufferSize: 4096 });
+    `, { eval: true, workerData: { module: path.join(__dirname, '..'), target: path.join(directory, 'out.pdf'), stop } });
+
+    const exited = new Promise((resolve, reject) => {
+        worker.on('error', reject);
+        worker.on('exit', resolve);
+    });
+
+    let direct = false;
+    const deadline = Date.now() + 10000;
+    while(!direct && Date.now() < deadline) {
+        const flags = findTemporaryFileFlags(directory);
+        direct = flags !== null && (flags & fs.constants.O_DIRECT) !== 0;
+    }
+
+    Atomics.store(stop, 0, 1);
+    await exited;
+    assert.ok(direct, 'the temporary file was never observed open with O_DIRECT');
+});